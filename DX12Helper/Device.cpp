@@ -28,6 +28,23 @@ void Device::CreateCBV(const dxh::Buffer& buffer, D3D12_CPU_DESCRIPTOR_HANDLE ha
   device->CreateConstantBufferView(&cbvDesc, handle);
 }
 
+void Device::CreateSRV(
+  const dxh::Buffer& buffer,
+  size_t stride,
+  D3D12_CPU_DESCRIPTOR_HANDLE handle
+)
+{
+  D3D12_SHADER_RESOURCE_VIEW_DESC desc{};
+  desc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+  desc.Format = DXGI_FORMAT_UNKNOWN;
+  desc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+  desc.Buffer.FirstElement = 0;
+  desc.Buffer.NumElements = static_cast<UINT>(buffer.ByteSize() / stride);
+  desc.Buffer.StructureByteStride = static_cast<UINT>(stride);
+  desc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_NONE;
+  device->CreateShaderResourceView(buffer.Resource(), &desc, handle);
+}
+
 void Device::CreateDSV(const dxh::Texture& texture, D3D12_CPU_DESCRIPTOR_HANDLE handle)
 {
   D3D12_DEPTH_STENCIL_VIEW_DESC dsvDesc{};
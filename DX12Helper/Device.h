@@ -24,6 +24,9 @@ public:
   void CreateCBV(const dxh::Buffer& buffer, D3D12_CPU_DESCRIPTOR_HANDLE handle);
   void CreateSRV(const dxh::Texture& texture, D3D12_CPU_DESCRIPTOR_HANDLE handle);
 
+  // Structured buffer view of the whole buffer with elements of `stride` bytes
+  void CreateSRV(const dxh::Buffer& buffer, size_t stride, D3D12_CPU_DESCRIPTOR_HANDLE handle);
+
   template<typename ElemType, size_t alignment>
   void CreateSRV(
     const dxh::UploadHeapArray<ElemType, alignment>& buffer,
@@ -19,16 +19,26 @@ void Fence::SignalToCommandQueue(ID3D12CommandQueue* cmdQueue, uint64_t value)
   ThrowIfFailed(cmdQueue->Signal(fence.Get(), value));
 }
 
-void Fence::FlushCommandQueue(ID3D12CommandQueue* cmdQueue)
+UINT64 Fence::Signal(ID3D12CommandQueue* cmdQueue)
 {
   auto fenceValue = ++nextFenceValue;
   SignalToCommandQueue(cmdQueue, fenceValue);
+  return fenceValue;
+}
 
-  if (fence->GetCompletedValue() < fenceValue) {
+void Fence::WaitForValue(UINT64 value)
+{
+  if (fence->GetCompletedValue() < value) {
     HANDLE event = CreateEvent(nullptr, FALSE, FALSE, nullptr);
-    ThrowIfFailed(fence->SetEventOnCompletion(fenceValue, event));
+    ThrowIfFailed(fence->SetEventOnCompletion(value, event));
     WaitForSingleObject(event, INFINITE);
+    CloseHandle(event);
   }
 }
 
+void Fence::FlushCommandQueue(ID3D12CommandQueue* cmdQueue)
+{
+  WaitForValue(Signal(cmdQueue));
+}
+
 }  // namespace dxh
\ No newline at end of file
@@ -13,14 +13,37 @@ public:
 
   void SignalToCommandQueue(ID3D12CommandQueue* cmdQueue, uint64_t value);
 
+  // Queues a signal of the next fence value and returns it
+  UINT64 Signal(ID3D12CommandQueue* cmdQueue);
+
   UINT64 GetCompletedValue() const { return fence->GetCompletedValue(); }
 
+  // Blocks the calling thread until the fence reaches `value`
+  void WaitForValue(UINT64 value);
+
   void FlushCommandQueue(ID3D12CommandQueue* cmdQueue);
 
+  ID3D12Fence* Get() const { return fence.Get(); }
+
 private:
   Microsoft::WRL::ComPtr<ID3D12Fence> fence;
   UINT64 nextFenceValue = 0;
 };
 
+// Fence signaled on one command queue, the fence interface FrameSync expects
+class QueueFence
+{
+public:
+  QueueFence(Fence& fence, ID3D12CommandQueue* cmdQueue) : fence{fence}, cmdQueue{cmdQueue} {}
+
+  uint64_t Signal() { return fence.Signal(cmdQueue); }
+  uint64_t CompletedValue() const { return fence.GetCompletedValue(); }
+  void WaitForValue(uint64_t value) { fence.WaitForValue(value); }
+
+private:
+  Fence& fence;
+  ID3D12CommandQueue* cmdQueue;
+};
+
 
 }  // namespace dxh
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace dxh
+{
+
+// Tracks which of `frameCount` frame slots the GPU may still be using, so per-frame resources are
+// rewritten only after the GPU finished the frame that last used them. FenceType provides
+//   uint64_t Signal()                    queues a signal of a new, larger value and returns it
+//   uint64_t CompletedValue() const      last value the GPU reached
+//   void WaitForValue(uint64_t value)    blocks until CompletedValue() >= value
+template<typename FenceType, size_t frameCount>
+class FrameSync
+{
+public:
+  static_assert(frameCount > 0);
+
+  explicit FrameSync(FenceType& fence) : fence{fence} {}
+
+  static constexpr size_t FrameCount() { return frameCount; }
+
+  size_t CurrentFrame() const { return currentFrame; }
+
+  // Fence value signaled after the last submission of `frame`, 0 if it was never submitted
+  uint64_t FrameFenceValue(size_t frame) const { return fenceValues[frame]; }
+
+  bool IsFrameComplete(size_t frame) const
+  {
+    return fence.CompletedValue() >= fenceValues[frame];
+  }
+
+  // Blocks until the GPU finished the previous use of the current slot
+  void BeginFrame() { WaitForFrame(currentFrame); }
+
+  // Signals the end of the current frame's GPU work, moves to the next slot and returns the
+  // signaled value
+  uint64_t EndFrame()
+  {
+    uint64_t fenceValue = fence.Signal();
+    fenceValues[currentFrame] = fenceValue;
+    currentFrame = (currentFrame + 1) % frameCount;
+    return fenceValue;
+  }
+
+  void WaitForFrame(size_t frame)
+  {
+    if (!IsFrameComplete(frame)) {
+      fence.WaitForValue(fenceValues[frame]);
+    }
+  }
+
+  // Blocks until every submitted frame finished, e.g. before releasing per-frame resources
+  void WaitForAllFrames()
+  {
+    for (size_t frame = 0; frame < frameCount; ++frame) {
+      WaitForFrame(frame);
+    }
+  }
+
+private:
+  FenceType& fence;
+  std::array<uint64_t, frameCount> fenceValues{};
+  size_t currentFrame = 0;
+};
+
+}  // namespace dxh
@@ -205,4 +205,19 @@ TriangleMeshData<VertexType, IndexType> CreateUnitBoxWithNormal()
   return meshData;
 }
 
+// 8 shared corners with normals along the diagonals, a cheaper box for distant levels of detail
+template<typename VertexType, typename IndexType>
+TriangleMeshData<VertexType, IndexType> CreateUnitBoxWithCornerNormal()
+{
+  auto meshData = CreateUnitBox<VertexType, IndexType>();
+  const float invLength = 1.0f / std::sqrt(3.0f);
+  for (auto& vertex : meshData.vertices) {
+    vertex.normal = {
+      vertex.position.x * 2.0f * invLength, vertex.position.y * 2.0f * invLength,
+      vertex.position.z * 2.0f * invLength
+    };
+  }
+  return meshData;
+}
+
 }  // namespace dxh
\ No newline at end of file
@@ -17,15 +17,20 @@
 
 // ---
 
+// Only the math is available elsewhere, for the headless culling benchmark
+#ifdef _WIN32
 #include <d3d12.h>
 #include <d3dcompiler.h>
 #include <dxgi1_6.h>
 #include <windows.h>
 #include <wrl/client.h>
+#endif
 
 // ---
 
+#ifdef _WIN32
 #include "D3DUtils.h"
 #include "d3dx12.h"
+#endif
 #include "DirectXMath.h"
 #include "DirectXPackedVector.h"
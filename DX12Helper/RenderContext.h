@@ -6,6 +6,7 @@
 #include "DescriptorHeap.h"
 #include "Device.h"
 #include "Fence.h"
+#include "FrameSync.h"
 #include "PCH.h"
 #include "SwapChain.h"
 
@@ -13,6 +14,15 @@
 namespace dxh
 {
 
+// Frames the CPU may record ahead of the GPU, one per swap chain buffer
+constexpr size_t kFramesInFlight = 2;
+
+// Per-frame state owned by the render context, applications keep their per-frame upload buffers
+// in arrays indexed by RenderContext::CurrentFrameIndex
+struct FrameContext {
+  std::unique_ptr<CommandAllocator> cmdAlloc;
+};
+
 struct RenderContext {
   explicit RenderContext(IDXGIFactory4* factory, HWND hwnd, int width, int height)
       : device{std::make_unique<Device>(factory)},
@@ -35,6 +45,11 @@ struct RenderContext {
     );
 
     fence = std::make_unique<Fence>(device->Get());
+    queueFence = std::make_unique<QueueFence>(*fence, cmdQueue->Get());
+    frameSync = std::make_unique<FrameSync<QueueFence, kFramesInFlight>>(*queueFence);
+    for (auto& frame : frames) {
+      frame.cmdAlloc = std::make_unique<CommandAllocator>(device->Get());
+    }
   }
 
   std::unique_ptr<Device> device;
@@ -47,9 +62,36 @@ struct RenderContext {
   std::unique_ptr<SwapChainManager<2>> swapChainManager;
   std::unique_ptr<CommandQueue> cmdQueue;
   std::unique_ptr<Fence> fence;
+  std::unique_ptr<QueueFence> queueFence;
+  std::unique_ptr<FrameSync<QueueFence, kFramesInFlight>> frameSync;
+  std::array<FrameContext, kFramesInFlight> frames;
 
   void FlushCommandQueue() const { fence->FlushCommandQueue(cmdQueue->Get()); }
 
+  size_t CurrentFrameIndex() const { return frameSync->CurrentFrame(); }
+
+  FrameContext& CurrentFrame() { return frames[CurrentFrameIndex()]; }
+
+  // Waits until the GPU finished the last frame recorded in the current slot and resets its
+  // command allocator, the slot's resources may be rewritten afterwards
+  FrameContext& BeginFrame()
+  {
+    frameSync->BeginFrame();
+    FrameContext& frame = CurrentFrame();
+    frame.cmdAlloc->Reset();
+    return frame;
+  }
+
+  // Presents and marks the end of the frame's GPU work without waiting for it, returns the fence
+  // value that signals its completion
+  uint64_t EndFrame()
+  {
+    Present();
+    return frameSync->EndFrame();
+  }
+
+  void WaitForAllFrames() { frameSync->WaitForAllFrames(); }
+
   void PrepareSwapChainForRender(GraphicsCommandList& cmdList) const
   {
     cmdList.Transition(*swapChainManager->CurrentBuffer(), D3D12_RESOURCE_STATE_RENDER_TARGET);
@@ -69,6 +69,9 @@ public:
 
   void Clear(int value) const { memset(bufferBegin, value, ByteSize()); }
 
+  // Mapped bytes for writing in place
+  void* Data() { return bufferBegin; }
+
   ~UploadHeapBuffer()
   {
     D3D12_RANGE range = {0, 0};
@@ -92,6 +95,13 @@ public:
 
   void LoadElement(size_t index, const ElemType& elem);
 
+  // Mapped elements for writing in place, only for arrays without padding
+  ElemType* Data()
+  {
+    assert(elemPaddedSize == sizeof(ElemType));
+    return static_cast<ElemType*>(bufferBegin);
+  }
+
 private:
   size_t elemCount = 0;
   int elemPaddedSize = 0;
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vector>
+
+#include "PCH.h"
+
+namespace dxh
+{
+
+// Source descriptors gathered for one contiguous destination range and copied with a single
+// CopyDescriptors call. Runs of handles that are adjacent in their heap become one source range
+class DescriptorCopyBatch
+{
+public:
+  explicit DescriptorCopyBatch(UINT incrementSize) : incrementSize{incrementSize} {}
+
+  void Clear()
+  {
+    srcStarts.clear();
+    srcSizes.clear();
+    descriptorCount = 0;
+  }
+
+  void Add(const D3D12_CPU_DESCRIPTOR_HANDLE* handles, size_t count)
+  {
+    for (size_t i = 0; i < count; ++i) {
+      if (!srcStarts.empty() &&
+          handles[i].ptr == srcStarts.back().ptr + SIZE_T{srcSizes.back()} * incrementSize) {
+        ++srcSizes.back();
+      } else {
+        srcStarts.push_back(handles[i]);
+        srcSizes.push_back(1);
+      }
+    }
+    descriptorCount += static_cast<UINT>(count);
+  }
+
+  UINT DescriptorCount() const { return descriptorCount; }
+  UINT SourceRangeCount() const { return static_cast<UINT>(srcStarts.size()); }
+
+  // Copies everything added to `count` descriptors starting at `dest`. DeviceType is ID3D12Device
+  // or a stand-in with the same CopyDescriptors
+  template<typename DeviceType>
+  void Copy(DeviceType* device, D3D12_CPU_DESCRIPTOR_HANDLE dest, D3D12_DESCRIPTOR_HEAP_TYPE type)
+    const
+  {
+    if (descriptorCount == 0) {
+      return;
+    }
+    device->CopyDescriptors(
+      1, &dest, &descriptorCount, SourceRangeCount(), srcStarts.data(), srcSizes.data(), type
+    );
+  }
+
+private:
+  UINT incrementSize = 0;
+  std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> srcStarts;
+  std::vector<UINT> srcSizes;
+  UINT descriptorCount = 0;
+};
+
+}  // namespace dxh
@@ -1,94 +1,88 @@
 #include "DescriptorHeap.h"
 
+#if defined(_MSC_VER)
+  #include <intrin.h>
+#endif
+
 
 namespace dxh
 {
 
 
-DescriptorHeap* DescriptorHeapPool::RequestHeap()
+namespace
 {
-  if (currentHeap) {
-    return currentHeap.get();
-  }
-
-  if (!availableHeaps.empty()) {
-    currentHeap = std::move(availableHeaps.front());
-    availableHeaps.pop();
-  } else {
-    currentHeap = std::make_unique<DescriptorHeap>(
-      device, D3D12_DESCRIPTOR_HEAP_DESC{type, descriptorsPerHeap, flag, 0}
-    );
-  }
-
-  nextAvailableIndex = 0;
-  return currentHeap.get();
-}
 
-DescriptorHeap* DescriptorHeapPool::CurrentHeap()
+// Expects bits != 0
+uint32_t LowestBit(uint64_t bits)
 {
-  if (!currentHeap) {
-    return RequestHeap();
-  }
-  return currentHeap.get();
+#if defined(_MSC_VER)
+  unsigned long index;
+  _BitScanForward64(&index, bits);
+  return static_cast<uint32_t>(index);
+#else
+  return static_cast<uint32_t>(__builtin_ctzll(bits));
+#endif
 }
 
-void DescriptorHeapPool::RetireHeap()
+// FNV-1a over the handle addresses
+uint64_t HashHandles(const D3D12_CPU_DESCRIPTOR_HANDLE* handles, UINT count)
 {
-  if (!currentHeap) {
-    return;
+  uint64_t hash = 14695981039346656037ull;
+  for (UINT i = 0; i < count; ++i) {
+    uint64_t ptr = handles[i].ptr;
+    for (int byte = 0; byte < 8; ++byte) {
+      hash = (hash ^ ((ptr >> (byte * 8)) & 0xff)) * 1099511628211ull;
+    }
   }
-
-  RetiredHeap retired;
-  retired.heap = std::move(currentHeap);
-  retired.fenced = false;
-  retiredHeaps.push(std::move(retired));
-  currentHeap.reset();
+  return hash;
 }
 
-void DescriptorHeapPool::RenewHeaps(ID3D12Fence* fence)
-{
-  uint64_t completedFence = fence->GetCompletedValue();
-  for (auto& r = retiredHeaps.front(); r.fenced && r.fenceValue <= completedFence;
-       retiredHeaps.pop()) {
-    availableHeaps.push(std::move(r.heap));
-  }
-}
+}  // namespace
 
-void DescriptorHeapPool::MarkRetiredHeaps(uint64_t fenceValue)
+size_t DescriptorTableCache::DescriptorCount(uint64_t rootMask) const
 {
-  std::queue<RetiredHeap> updated;
-  while (!retiredHeaps.empty()) {
-    auto& r = retiredHeaps.front();
-    if (!r.fenced) {
-      r.fenceValue = fenceValue;
-      r.fenced = true;
-    }
-    updated.push(std::move(r));
-    retiredHeaps.pop();
+  size_t count = 0;
+  for (uint64_t mask = rootMask; mask != 0; mask &= mask - 1) {
+    count += tables[LowestBit(mask)].descriptorCount;
   }
-  retiredHeaps = std::move(updated);
+  return count;
 }
 
 void DynamicDescriptorHeap::ParseRootSignature(const RootSignature& rootSignature)
 {
-  cache.rootIndexToTable.clear();
+  assert(rootSignature.ParameterCount() <= DescriptorTableCache::kMaxRootParameters);
+  cache.Clear();
 
+  UINT handleCount = 0;
   for (size_t i = 0; i < rootSignature.ParameterCount(); ++i) {
     const D3D12_ROOT_PARAMETER& param = rootSignature.Parameter(i);
     if (param.ParameterType != D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE) {
       continue;
     }
     auto rangeCount = param.DescriptorTable.NumDescriptorRanges;
-    size_t descriptorCount = 0;
+    UINT descriptorCount = 0;
     for (size_t j = 0; j < rangeCount; ++j) {
       const D3D12_DESCRIPTOR_RANGE& range = param.DescriptorTable.pDescriptorRanges[j];
       descriptorCount += range.NumDescriptors;
     }
-    DescriptorTableCache::TableEntry entry{};
-    entry.dirty = false;
-    entry.handles.resize(descriptorCount);
-    cache.rootIndexToTable[i] = std::move(entry);
+    cache.tables[i] = {handleCount, descriptorCount};
+    cache.tableMask |= uint64_t{1} << i;
+    handleCount += descriptorCount;
   }
+  cache.handles.resize(handleCount);
+}
+
+void DynamicDescriptorHeap::EnableTableReuse(bool enable)
+{
+  tableReuse = enable;
+  copiedTables.clear();
+}
+
+void DynamicDescriptorHeap::InvalidateCopiedTables()
+{
+  copiedTables.clear();
+  // The bound copies hold the old descriptors too
+  cache.MarkAllDirty();
 }
 
 void DynamicDescriptorHeap::SetDescriptors(
@@ -98,13 +92,14 @@ void DynamicDescriptorHeap::SetDescriptors(
   const D3D12_CPU_DESCRIPTOR_HANDLE handles[]
 )
 {
-  assert(cache.rootIndexToTable.count(rootIndex));
-
-  DescriptorTableCache::TableEntry& entry = cache.rootIndexToTable[rootIndex];
-  assert(offset < entry.DescriptorCount());
-  assert(offset + count <= entry.DescriptorCount());
-  entry.dirty = true;
-  std::copy(handles, handles + count, std::begin(entry.handles) + offset);
+  assert(rootIndex < DescriptorTableCache::kMaxRootParameters);
+  assert(cache.tableMask & (uint64_t{1} << rootIndex));
+
+  const DescriptorTableCache::TableEntry& entry = cache.tables[rootIndex];
+  assert(offset < entry.descriptorCount);
+  assert(offset + count <= entry.descriptorCount);
+  cache.dirtyMask |= uint64_t{1} << rootIndex;
+  std::copy(handles, handles + count, cache.Handles(rootIndex) + offset);
 }
 
 void DynamicDescriptorHeap::BindModifiedDescriptors(
@@ -116,41 +111,87 @@ void DynamicDescriptorHeap::BindModifiedDescriptors(
     return;
   }
 
-  size_t descriptorsToAlloc = cache.StagedDescriptorCount();
-  assert(
-    descriptorsToAlloc <= heapPool.MaxDescriptorsPerHeap() &&
-    "Descriptors to allocate are more than available even for newly requested heap"
-  );
-
-  if (!heapPool.CanAllocate(descriptorsToAlloc)) {
-    cache.MarkAllDirty();
-    heapPool.RetireHeap();
-    heapPool.RequestHeap();
-    BindModifiedDescriptors(device, commandList);
+  commandList->SetDescriptorHeaps(1, heap.HeapAddress());
+
+  // Tables with a copy left from earlier draws are bound to it, the rest are copied
+  std::array<uint64_t, DescriptorTableCache::kMaxRootParameters> hashes;
+  uint64_t copyMask = cache.dirtyMask;
+  if (tableReuse) {
+    for (uint64_t mask = cache.dirtyMask; mask != 0; mask &= mask - 1) {
+      uint32_t rootIndex = LowestBit(mask);
+      hashes[rootIndex] =
+        HashHandles(cache.Handles(rootIndex), cache.tables[rootIndex].descriptorCount);
+      UINT offset = FindCopiedTable(rootIndex, hashes[rootIndex]);
+      if (offset != DescriptorRing::kInvalidOffset) {
+        commandList->SetGraphicsRootDescriptorTable(rootIndex, heap.GPUHandle(offset));
+        copyMask &= ~(uint64_t{1} << rootIndex);
+      }
+    }
+  }
+  if (copyMask == 0) {
+    cache.ClearDirty();
     return;
   }
 
-  commandList->SetDescriptorHeaps(1, heapPool.CurrentHeap()->HeapAddress());
+  // All copied tables go to one range of the ring
+  auto descriptorsToAlloc = static_cast<UINT>(cache.DescriptorCount(copyMask));
+  UINT baseIndex = ring.Allocate(descriptorsToAlloc, fence);
+  if (baseIndex == DescriptorRing::kInvalidOffset) {
+    throw std::runtime_error{"Descriptors staged in one frame exceed the descriptor ring"};
+  }
+  // Copies of the previous lap are overwritten from here on
+  if (ring.Lap() != copiedTablesLap) {
+    copiedTables.clear();
+    copiedTablesLap = ring.Lap();
+  }
 
-  for (auto& [rootIndex, entry] : cache.rootIndexToTable) {
-    if (!entry.dirty) {
-      continue;
+  // Copied tables are laid out back to back, so a single copy fills all of them
+  copyBatch.Clear();
+  UINT tableIndex = baseIndex;
+  for (uint64_t mask = copyMask; mask != 0; mask &= mask - 1) {
+    uint32_t rootIndex = LowestBit(mask);
+    const DescriptorTableCache::TableEntry& entry = cache.tables[rootIndex];
+    const D3D12_CPU_DESCRIPTOR_HANDLE* handles = cache.Handles(rootIndex);
+    copyBatch.Add(handles, entry.descriptorCount);
+    commandList->SetGraphicsRootDescriptorTable(rootIndex, heap.GPUHandle(tableIndex));
+    if (tableReuse) {
+      copiedTables[hashes[rootIndex]] = {
+        tableIndex, {handles, handles + entry.descriptorCount}
+      };
     }
+    tableIndex += entry.descriptorCount;
+  }
+  copyBatch.Copy(device, heap.CPUHandle(baseIndex), heap.Type());
+  cache.ClearDirty();
+}
 
-    // Copy descriptors in dirty entry to newly allocated space in heap
-    auto extraDescriptorCount = entry.DescriptorCount();
-    UINT baseIndex = heapPool.NextAvailableIndex();
-    DescriptorHeap* currentHeap = heapPool.CurrentHeap();
-    const auto& srcDescriptors = entry.handles;
+UINT DynamicDescriptorHeap::FindCopiedTable(uint32_t rootIndex, uint64_t hash)
+{
+  auto it = copiedTables.find(hash);
+  if (it == copiedTables.end()) {
+    return DescriptorRing::kInvalidOffset;
+  }
 
-    for (size_t i = 0; i < extraDescriptorCount; ++i) {
-      device->CopyDescriptorsSimple(
-        1, currentHeap->CPUHandle(baseIndex + i), srcDescriptors[i], currentHeap->Type()
-      );
-    }
+  const DescriptorTableCache::TableEntry& entry = cache.tables[rootIndex];
+  const D3D12_CPU_DESCRIPTOR_HANDLE* handles = cache.Handles(rootIndex);
+  const CopiedTable& table = it->second;
+  bool sameHandles = std::equal(
+    handles, handles + entry.descriptorCount, table.handles.begin(), table.handles.end(),
+    [](D3D12_CPU_DESCRIPTOR_HANDLE a, D3D12_CPU_DESCRIPTOR_HANDLE b) { return a.ptr == b.ptr; }
+  );
 
-    commandList->SetGraphicsRootDescriptorTable(rootIndex, currentHeap->GPUHandle(baseIndex));
+  // The copy is gone once its slots were reclaimed, they may be written again any time
+  if (!sameHandles || !ring.Retain(table.offset)) {
+    copiedTables.erase(it);
+    return DescriptorRing::kInvalidOffset;
   }
+  return table.offset;
+}
+
+void DynamicDescriptorHeap::FinishFrame(uint64_t fenceValue)
+{
+  ring.FinishFrame(fenceValue);
+  cache.MarkAllDirty();
 }
 
 
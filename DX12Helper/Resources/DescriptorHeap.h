@@ -1,10 +1,15 @@
 #pragma once
 
 
-#include <queue>
+#include <array>
+#include <cstdint>
 #include <unordered_map>
-#include <utility>
+#include <vector>
 
+#include "DescriptorCopyBatch.h"
+#include "DescriptorRangeAllocator.h"
+#include "DescriptorRing.h"
+#include "Fence.h"
 #include "PCH.h"
 #include "RootSignature.h"
 
@@ -34,6 +39,7 @@ public:
 
   D3D12_DESCRIPTOR_HEAP_TYPE Type() const { return desc.Type; }
   UINT Count() const { return desc.NumDescriptors; }
+  UINT IncrementSize() const { return incrementSize; }
 
   CD3DX12_CPU_DESCRIPTOR_HANDLE CPUHandle(UINT index)
   {
@@ -57,6 +63,9 @@ private:
   Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> heap;
 };
 
+// Descriptor heaps of `descriptorsPerHeap` descriptors each. Ranges are freed individually and
+// reused, a new heap is created only when no heap has a large enough free range. Allocate tries
+// the heaps one by one, O(#heaps) when the newest ones are full, Free finds the heap in O(1)
 template<
   D3D12_DESCRIPTOR_HEAP_TYPE heapType,
   D3D12_DESCRIPTOR_HEAP_FLAGS flag,
@@ -72,39 +81,80 @@ public:
 
   CD3DX12_CPU_DESCRIPTOR_HANDLE Allocate(UINT count = 1)
   {
-    if (heaps.empty() || AvailableDescriptorCount() < count) {
-      RequestHeap();
+    assert(count > 0 && count <= descriptorsPerHeap);
+
+    // Newest heaps first, older ones are mostly full
+    for (size_t i = heaps.size(); i-- > 0;) {
+      UINT offset = heaps[i].allocator.Allocate(count);
+      if (offset != DescriptorRangeAllocator::kInvalidOffset) {
+        return TrackAllocation(i, offset);
+      }
     }
 
-    CD3DX12_CPU_DESCRIPTOR_HANDLE handle = heaps.back().CPUHandle(nextAvailableIndex);
-    nextAvailableIndex += count;
+    PoolHeap& newHeap = RequestHeap();
+    return TrackAllocation(heaps.size() - 1, newHeap.allocator.Allocate(count));
+  }
 
-    return handle;
+  // Returns `count` descriptors starting at `handle`, as returned by Allocate(count)
+  void Free(D3D12_CPU_DESCRIPTOR_HANDLE handle, UINT count = 1)
+  {
+    auto it = allocationHeaps.find(handle.ptr);
+    assert(it != allocationHeaps.end() && "Descriptor handle does not belong to this pool");
+    PoolHeap& poolHeap = heaps[it->second];
+    allocationHeaps.erase(it);
+
+    UINT offset = static_cast<UINT>((handle.ptr - poolHeap.heap.CPUHandle(0).ptr) / incrementSize);
+    poolHeap.allocator.Free(offset, count);
   }
 
   void FreeAll()
   {
     heaps.clear();
-    nextAvailableIndex = 0;
+    allocationHeaps.clear();
+  }
+
+  // Free descriptors summed over every heap, largestFreeRange is the largest of any heap
+  DescriptorRangeStats Stats() const
+  {
+    DescriptorRangeStats total;
+    for (const PoolHeap& poolHeap : heaps) {
+      DescriptorRangeStats stats = poolHeap.allocator.Stats();
+      total.capacity += stats.capacity;
+      total.freeCount += stats.freeCount;
+      total.freeRangeCount += stats.freeRangeCount;
+      total.largestFreeRange = std::max(total.largestFreeRange, stats.largestFreeRange);
+    }
+    return total;
   }
 
 private:
-  void RequestHeap()
+  struct PoolHeap {
+    DescriptorHeap heap;
+    DescriptorRangeAllocator allocator;
+  };
+
+  PoolHeap& RequestHeap()
   {
-    heaps.emplace_back(device, heapType, descriptorsPerHeap, flag);
-    nextAvailableIndex = 0;
+    heaps.push_back(
+      {DescriptorHeap{device, heapType, descriptorsPerHeap, flag},
+       DescriptorRangeAllocator{descriptorsPerHeap}}
+    );
+    return heaps.back();
   }
 
-  UINT AvailableDescriptorCount() const
+  CD3DX12_CPU_DESCRIPTOR_HANDLE TrackAllocation(size_t heapIndex, UINT offset)
   {
-    return heaps.empty() ? 0 : heaps.back().Count() - nextAvailableIndex;
+    CD3DX12_CPU_DESCRIPTOR_HANDLE handle = heaps[heapIndex].heap.CPUHandle(offset);
+    allocationHeaps.emplace(handle.ptr, static_cast<uint32_t>(heapIndex));
+    return handle;
   }
 
 
   ID3D12Device* device = nullptr;
   UINT incrementSize = 0;
-  std::vector<DescriptorHeap> heaps;
-  UINT nextAvailableIndex = 0;
+  std::vector<PoolHeap> heaps;
+  // Heap of every live allocation by its first CPU handle
+  std::unordered_map<SIZE_T, uint32_t> allocationHeaps;
 };
 
 using CbvSrvUavPool =
@@ -112,122 +162,73 @@ using CbvSrvUavPool =
 using RTVPool = DescriptorPool<D3D12_DESCRIPTOR_HEAP_TYPE_RTV, D3D12_DESCRIPTOR_HEAP_FLAG_NONE>;
 using DSVPool = DescriptorPool<D3D12_DESCRIPTOR_HEAP_TYPE_DSV, D3D12_DESCRIPTOR_HEAP_FLAG_NONE>;
 
-class DescriptorHeapPool
-{
-public:
-  DescriptorHeapPool(
-    ID3D12Device* device,
-    D3D12_DESCRIPTOR_HEAP_TYPE type,
-    D3D12_DESCRIPTOR_HEAP_FLAGS flag,
-    UINT descriptorsPerHeap = 1024
-  )
-      : device{device},
-        type{type},
-        flag{flag},
-        descriptorsPerHeap{descriptorsPerHeap}
-  {
-  }
-
-  DescriptorHeap* RequestHeap();
-
-  DescriptorHeap* CurrentHeap();
-
-  void RetireHeap();
-
-  void RenewHeaps(ID3D12Fence* fence);
-
-  void MarkRetiredHeaps(uint64_t fenceValue);
-
-  UINT NextAvailableIndex() const { return nextAvailableIndex; }
-
-  UINT AvailableDescriptorCount() const
-  {
-    return currentHeap ? currentHeap->Count() - nextAvailableIndex : 0;
-  }
-
-  bool CanAllocate(UINT count) const { return count <= AvailableDescriptorCount(); }
-
-  D3D12_CPU_DESCRIPTOR_HANDLE Allocate(UINT count)
-  {
-    assert(CanAllocate(count));
-
-    if (!currentHeap) {
-      RequestHeap();
-    }
-
-    D3D12_CPU_DESCRIPTOR_HANDLE handle = currentHeap->CPUHandle(nextAvailableIndex);
-    nextAvailableIndex += count;
-
-    return handle;
-  }
-
-  UINT MaxDescriptorsPerHeap() const { return descriptorsPerHeap; }
-
-private:
-  ID3D12Device* device;
-  D3D12_DESCRIPTOR_HEAP_TYPE type;
-  D3D12_DESCRIPTOR_HEAP_FLAGS flag;
-  UINT descriptorsPerHeap = 1024;
-
-  std::unique_ptr<DescriptorHeap> currentHeap;
-  UINT nextAvailableIndex = 0;
-
-  struct RetiredHeap {
-    std::unique_ptr<DescriptorHeap> heap;
-    uint64_t fenceValue;
-    bool fenced = false;
-  };
-
-  std::queue<RetiredHeap> retiredHeaps;
-  std::queue<std::unique_ptr<DescriptorHeap>> availableHeaps;
-};
-
+// Descriptor tables of the bound root signature. Handles of all tables share one array and
+// tables modified since the last bind are the set bits of dirtyMask
 struct DescriptorTableCache {
+  // Root signatures are limited to 64 DWORDs, so to 64 parameters
+  static constexpr size_t kMaxRootParameters = 64;
 
   struct TableEntry {
-    bool dirty;
-    std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> handles;
-    size_t DescriptorCount() const { return handles.size(); }
+    UINT handleOffset = 0;  // First handle of the table in `handles`
+    UINT descriptorCount = 0;
   };
 
-  std::unordered_map<size_t, TableEntry> rootIndexToTable;
+  std::array<TableEntry, kMaxRootParameters> tables{};
+  std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> handles;
+  uint64_t tableMask = 0;  // Root indices that are descriptor tables
+  uint64_t dirtyMask = 0;
 
-  size_t StagedDescriptorCount() const
+  D3D12_CPU_DESCRIPTOR_HANDLE* Handles(size_t rootIndex)
   {
-    return std::accumulate(
-      std::begin(rootIndexToTable), std::end(rootIndexToTable), 0, [](size_t sum, const auto& p) {
-        return sum + (p.second.dirty ? p.second.DescriptorCount() : 0);
-      }
-    );
+    return handles.data() + tables[rootIndex].handleOffset;
   }
 
-  void Clear() { rootIndexToTable.clear(); }
+  // Descriptors in the tables whose root index bits are set in `rootMask`
+  size_t DescriptorCount(uint64_t rootMask) const;
 
-  bool IsDirty() const
+  void Clear()
   {
-    return std::any_of(std::begin(rootIndexToTable), std::end(rootIndexToTable), [](const auto& p) {
-      return p.second.dirty;
-    });
+    tables = {};
+    handles.clear();
+    tableMask = 0;
+    dirtyMask = 0;
   }
 
-  void MarkAllDirty()
-  {
-    for (auto& [rootIndex, entry] : rootIndexToTable) {
-      entry.dirty = true;
-    }
-  }
+  bool IsDirty() const { return dirtyMask != 0; }
+  void MarkAllDirty() { dirtyMask = tableMask; }
+  void ClearDirty() { dirtyMask = 0; }
 };
 
+// Descriptor tables staged from CPU descriptors and copied into one shader-visible heap used as a
+// ring, so command lists never switch heaps. Copies of a frame are reclaimed once `fence` passes
+// the value given to FinishFrame
 class DynamicDescriptorHeap
 {
 public:
-  DynamicDescriptorHeap(ID3D12Device* device, D3D12_DESCRIPTOR_HEAP_TYPE type)
-      : heapPool{device, type, D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE}
+  DynamicDescriptorHeap(
+    ID3D12Device* device,
+    D3D12_DESCRIPTOR_HEAP_TYPE type,
+    QueueFence& fence,
+    UINT descriptorCount = 4096
+  )
+      : heap{device, type, descriptorCount, D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE},
+        ring{descriptorCount},
+        fence{fence},
+        copyBatch{heap.IncrementSize()}
   {
   }
 
   void ParseRootSignature(const RootSignature& rootSignature);
 
+  // Off by default. When on, a table whose source handles equal those of a table copied earlier in
+  // the current ring lap binds that copy again instead of copying
+  void EnableTableReuse(bool enable);
+
+  // Call after writing a new descriptor over a CPU handle that is staged or was copied before.
+  // Reuse only compares handles, so without this the old contents would be bound again. The next
+  // BindModifiedDescriptors copies every table
+  void InvalidateCopiedTables();
+
   void SetDescriptors(
     UINT rootIndex,
     UINT offset,
@@ -235,12 +236,36 @@ public:
     const D3D12_CPU_DESCRIPTOR_HANDLE handles[]
   );
 
-
+  // Copies the tables modified since the last call with one CopyDescriptors call and binds them.
+  // Waits for older frames when the ring is full. With table reuse, tables copied before are bound
+  // where they are and kept from being reclaimed until this frame completes
   void BindModifiedDescriptors(ID3D12Device* device, ID3D12GraphicsCommandList* commandList);
 
+  // Call once the frame's command lists are submitted with the fence value signaled after them.
+  // Tables are bound again in the next command list
+  void FinishFrame(uint64_t fenceValue);
+
+  const DescriptorRing& Ring() const { return ring; }
+
 private:
-  DescriptorHeapPool heapPool;
+  // A table copied into the ring, keyed by the hash of its source handles
+  struct CopiedTable {
+    UINT offset;
+    std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> handles;
+  };
+
+  // Ring offset of a copy of the table at `rootIndex`, kInvalidOffset when there is none
+  UINT FindCopiedTable(uint32_t rootIndex, uint64_t hash);
+
+  DescriptorHeap heap;
+  DescriptorRing ring;
+  QueueFence& fence;
   DescriptorTableCache cache;
+  DescriptorCopyBatch copyBatch;
+
+  bool tableReuse = false;
+  uint64_t copiedTablesLap = 0;  // Ring lap the copies were made in, they are dropped on the next
+  std::unordered_map<uint64_t, CopiedTable> copiedTables;
 };
 
 
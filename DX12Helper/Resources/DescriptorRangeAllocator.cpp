@@ -0,0 +1,228 @@
+#include "DescriptorRangeAllocator.h"
+
+#include <algorithm>
+#include <cassert>
+
+#if defined(_MSC_VER)
+  #include <intrin.h>
+#endif
+
+namespace dxh
+{
+
+namespace
+{
+
+// Both expect bits != 0
+uint32_t LowestBit(uint32_t bits)
+{
+#if defined(_MSC_VER)
+  unsigned long index;
+  _BitScanForward(&index, bits);
+  return static_cast<uint32_t>(index);
+#else
+  return static_cast<uint32_t>(__builtin_ctz(bits));
+#endif
+}
+
+uint32_t HighestBit(uint32_t bits)
+{
+#if defined(_MSC_VER)
+  unsigned long index;
+  _BitScanReverse(&index, bits);
+  return static_cast<uint32_t>(index);
+#else
+  return static_cast<uint32_t>(31 - __builtin_clz(bits));
+#endif
+}
+
+}  // namespace
+
+void DescriptorRangeAllocator::Reset(uint32_t capacity)
+{
+  blocks.assign(capacity, {});
+  freeBlockStart.assign(capacity, kInvalidOffset);
+  firstLevelMask = 0;
+  secondLevelMasks.fill(0);
+  for (auto& heads : freeHeads) {
+    heads.fill(kInvalidOffset);
+  }
+  freeCount = capacity;
+  freeRangeCount = 0;
+
+  if (capacity > 0) {
+    InsertFree(0, capacity);
+  }
+}
+
+// Sizes below kSecondLevelCount get a class each, larger ones split every power of two range
+// into kSecondLevelCount classes
+DescriptorRangeAllocator::SizeClass DescriptorRangeAllocator::ClassOf(uint32_t size)
+{
+  if (size < kSecondLevelCount) {
+    return {0, size};
+  }
+  uint32_t highestBit = HighestBit(size);
+  uint32_t shift = highestBit - kSecondLevelBits;
+  return {shift + 1, (size >> shift) - kSecondLevelCount};
+}
+
+uint32_t DescriptorRangeAllocator::Allocate(uint32_t count)
+{
+  if (count == 0 || count > freeCount) {
+    return kInvalidOffset;
+  }
+
+  // Round up to the next class boundary, every range of that class or above fits
+  uint32_t searchSize = count;
+  if (count >= kSecondLevelCount) {
+    uint32_t roundUp = (1u << (HighestBit(count) - kSecondLevelBits)) - 1;
+    if (count > UINT32_MAX - roundUp) {
+      return kInvalidOffset;
+    }
+    searchSize += roundUp;
+  }
+  SizeClass sizeClass = ClassOf(searchSize);
+
+  // First non-empty list of this class or a larger one, then of the next larger power of two range
+  uint32_t offset = kInvalidOffset;
+  uint32_t firstLevel = sizeClass.firstLevel;
+  uint32_t secondMask = secondLevelMasks[firstLevel] & (~0u << sizeClass.secondLevel);
+  if (secondMask == 0) {
+    uint32_t firstMask = firstLevelMask & (~0u << (firstLevel + 1));
+    if (firstMask != 0) {
+      firstLevel = LowestBit(firstMask);
+      secondMask = secondLevelMasks[firstLevel];
+    }
+  }
+  if (secondMask != 0) {
+    offset = freeHeads[firstLevel][LowestBit(secondMask)];
+  } else {
+    offset = FindInOwnClass(count);
+    if (offset == kInvalidOffset) {
+      return kInvalidOffset;
+    }
+  }
+  assert(offset != kInvalidOffset && blocks[offset].size >= count);
+
+  uint32_t size = blocks[offset].size;
+  RemoveFree(offset);
+  if (size > count) {
+    InsertFree(offset + count, size - count);
+  }
+  blocks[offset].size = count;
+  freeCount -= count;
+  return offset;
+}
+
+// Ranges of `count`'s own class may be smaller than it, the list is walked for one that fits
+uint32_t DescriptorRangeAllocator::FindInOwnClass(uint32_t count) const
+{
+  SizeClass sizeClass = ClassOf(count);
+  uint32_t offset = freeHeads[sizeClass.firstLevel][sizeClass.secondLevel];
+  while (offset != kInvalidOffset && blocks[offset].size < count) {
+    offset = blocks[offset].nextFree;
+  }
+  return offset;
+}
+
+void DescriptorRangeAllocator::Free(uint32_t offset, uint32_t count)
+{
+  assert(offset < blocks.size() && !blocks[offset].free && blocks[offset].size == count);
+  freeCount += count;
+
+  uint32_t start = offset;
+  uint32_t size = count;
+
+  uint32_t next = offset + count;
+  if (next < blocks.size() && blocks[next].free) {
+    size += blocks[next].size;
+    RemoveFree(next);
+    blocks[next].size = 0;
+  }
+
+  if (offset > 0) {
+    uint32_t prev = freeBlockStart[offset - 1];
+    if (prev != kInvalidOffset) {
+      start = prev;
+      size += blocks[prev].size;
+      RemoveFree(prev);
+    }
+  }
+
+  blocks[offset].size = 0;
+  InsertFree(start, size);
+}
+
+void DescriptorRangeAllocator::InsertFree(uint32_t offset, uint32_t size)
+{
+  SizeClass sizeClass = ClassOf(size);
+  uint32_t& head = freeHeads[sizeClass.firstLevel][sizeClass.secondLevel];
+
+  Block& block = blocks[offset];
+  block.size = size;
+  block.free = true;
+  block.prevFree = kInvalidOffset;
+  block.nextFree = head;
+  if (head != kInvalidOffset) {
+    blocks[head].prevFree = offset;
+  }
+  head = offset;
+  freeBlockStart[offset + size - 1] = offset;
+
+  firstLevelMask |= 1u << sizeClass.firstLevel;
+  secondLevelMasks[sizeClass.firstLevel] |= 1u << sizeClass.secondLevel;
+  ++freeRangeCount;
+}
+
+void DescriptorRangeAllocator::RemoveFree(uint32_t offset)
+{
+  Block& block = blocks[offset];
+  assert(block.free);
+  SizeClass sizeClass = ClassOf(block.size);
+  uint32_t& head = freeHeads[sizeClass.firstLevel][sizeClass.secondLevel];
+
+  if (block.prevFree != kInvalidOffset) {
+    blocks[block.prevFree].nextFree = block.nextFree;
+  } else {
+    head = block.nextFree;
+  }
+  if (block.nextFree != kInvalidOffset) {
+    blocks[block.nextFree].prevFree = block.prevFree;
+  }
+
+  if (head == kInvalidOffset) {
+    uint32_t& secondMask = secondLevelMasks[sizeClass.firstLevel];
+    secondMask &= ~(1u << sizeClass.secondLevel);
+    if (secondMask == 0) {
+      firstLevelMask &= ~(1u << sizeClass.firstLevel);
+    }
+  }
+
+  freeBlockStart[offset + block.size - 1] = kInvalidOffset;
+  block.free = false;
+  block.prevFree = kInvalidOffset;
+  block.nextFree = kInvalidOffset;
+  --freeRangeCount;
+}
+
+DescriptorRangeStats DescriptorRangeAllocator::Stats() const
+{
+  DescriptorRangeStats stats;
+  stats.capacity = Capacity();
+  stats.freeCount = freeCount;
+  stats.freeRangeCount = freeRangeCount;
+
+  // The largest range is in the highest non-empty class, only that list is walked
+  if (firstLevelMask != 0) {
+    uint32_t firstLevel = HighestBit(firstLevelMask);
+    uint32_t secondLevel = HighestBit(secondLevelMasks[firstLevel]);
+    for (uint32_t offset = freeHeads[firstLevel][secondLevel]; offset != kInvalidOffset;
+         offset = blocks[offset].nextFree) {
+      stats.largestFreeRange = std::max(stats.largestFreeRange, blocks[offset].size);
+    }
+  }
+  return stats;
+}
+
+}  // namespace dxh
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace dxh
+{
+
+struct DescriptorRangeStats {
+  uint32_t capacity = 0;
+  uint32_t freeCount = 0;
+  uint32_t freeRangeCount = 0;
+  uint32_t largestFreeRange = 0;
+
+  // 0 when all free descriptors form one range, approaches 1 as they scatter into small ranges
+  float Fragmentation() const
+  {
+    return freeCount == 0 ? 0.f
+                          : 1.f - static_cast<float>(largestFreeRange) / static_cast<float>(freeCount);
+  }
+};
+
+// Allocates ranges of consecutive slots out of `capacity` slots, e.g. descriptors of one heap.
+// Two-level segregated free lists (TLSF): free ranges are binned by size into lists found with two
+// bitmap scans, so Free is O(1) and so is Allocate unless only a range of the request's own class
+// fits, then that list is walked. Freed ranges merge with free neighbors right away.
+// Needs no device, offsets are turned into handles by the owner
+class DescriptorRangeAllocator
+{
+public:
+  static constexpr uint32_t kInvalidOffset = UINT32_MAX;
+
+  DescriptorRangeAllocator() = default;
+  explicit DescriptorRangeAllocator(uint32_t capacity) { Reset(capacity); }
+
+  // Drops every allocation, all `capacity` slots become one free range
+  void Reset(uint32_t capacity);
+
+  // Offset of `count` consecutive free slots, kInvalidOffset when no free range is large enough.
+  // Picks from the smallest size class that surely fits. Only when that class and all larger ones
+  // are empty, the list of `count`'s own class is walked for a range that fits
+  uint32_t Allocate(uint32_t count);
+
+  // Returns a range from Allocate, `count` must be the count it was allocated with
+  void Free(uint32_t offset, uint32_t count);
+
+  uint32_t Capacity() const { return static_cast<uint32_t>(blocks.size()); }
+  uint32_t FreeCount() const { return freeCount; }
+
+  DescriptorRangeStats Stats() const;
+
+private:
+  static constexpr uint32_t kSecondLevelBits = 3;
+  static constexpr uint32_t kSecondLevelCount = 1u << kSecondLevelBits;
+  static constexpr uint32_t kFirstLevelCount = 32 - kSecondLevelBits + 1;
+
+  // Tags of the block starting at a slot, only meaningful for block starts
+  struct Block {
+    uint32_t size = 0;
+    uint32_t prevFree = kInvalidOffset;  // Neighbors in the free list of its size class
+    uint32_t nextFree = kInvalidOffset;
+    bool free = false;
+  };
+
+  struct SizeClass {
+    uint32_t firstLevel;
+    uint32_t secondLevel;
+  };
+
+  static SizeClass ClassOf(uint32_t size);
+
+  uint32_t FindInOwnClass(uint32_t count) const;
+
+  void InsertFree(uint32_t offset, uint32_t size);
+  void RemoveFree(uint32_t offset);
+
+  std::vector<Block> blocks;
+  std::vector<uint32_t> freeBlockStart;  // At the last slot of a free block, its first slot
+
+  uint32_t firstLevelMask = 0;
+  std::array<uint32_t, kFirstLevelCount> secondLevelMasks{};
+  std::array<std::array<uint32_t, kSecondLevelCount>, kFirstLevelCount> freeHeads{};
+
+  uint32_t freeCount = 0;
+  uint32_t freeRangeCount = 0;
+};
+
+}  // namespace dxh
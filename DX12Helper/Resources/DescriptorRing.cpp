@@ -0,0 +1,74 @@
+#include "DescriptorRing.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace dxh
+{
+
+uint32_t DescriptorRing::Allocate(uint32_t count)
+{
+  if (count == 0 || count > capacity) {
+    return kInvalidOffset;
+  }
+
+  // A range that does not fit before the end of the heap starts the next lap, the slots left at the
+  // end stay in use until the frame is reclaimed
+  uint64_t start = head;
+  uint64_t offset = head % capacity;
+  if (offset + count > capacity) {
+    start += capacity - offset;
+  }
+
+  // Nothing in use, the skipped slots are free right away
+  if (head == tail) {
+    tail = start;
+  }
+  if (start + count - tail > capacity) {
+    return kInvalidOffset;
+  }
+
+  head = start + count;
+  lapStart = start - start % capacity;
+  return static_cast<uint32_t>(start % capacity);
+}
+
+void DescriptorRing::FinishFrame(uint64_t fenceValue)
+{
+  if (head == frameStart && currentFrameRetained == kNothingRetained) {
+    return;
+  }
+  assert(pendingFrames.empty() || pendingFrames.back().fenceValue <= fenceValue);
+  pendingFrames.push_back({fenceValue, head, currentFrameRetained});
+  frameStart = head;
+  currentFrameRetained = kNothingRetained;
+}
+
+void DescriptorRing::Reclaim(uint64_t completedValue)
+{
+  uint64_t end = tail;
+  while (!pendingFrames.empty() && pendingFrames.front().fenceValue <= completedValue) {
+    end = pendingFrames.front().end;
+    pendingFrames.pop_front();
+  }
+
+  // Slots retained by frames still pending or being recorded stay in use
+  uint64_t retained = currentFrameRetained;
+  for (const PendingFrame& frame : pendingFrames) {
+    retained = std::min(retained, frame.retained);
+  }
+  tail = std::max(tail, std::min(end, retained));
+}
+
+bool DescriptorRing::Retain(uint32_t offset)
+{
+  uint64_t position = lapStart + offset;
+  assert(position < head);
+  if (position < tail || head - position > capacity / 2) {
+    return false;
+  }
+  currentFrameRetained = std::min(currentFrameRetained, position);
+  return true;
+}
+
+}  // namespace dxh
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+namespace dxh
+{
+
+// Slots of one large shader-visible heap handed out in allocation order. Everything allocated
+// during a frame is tagged with the fence value signaled after it and reclaimed as a whole once the
+// fence completes. A range never wraps, slots left at the end of the heap are skipped and reclaimed
+// with the frame that skipped them. A frame may retain slots of an earlier frame of the same lap to
+// read them again, they are then reclaimed with it. Needs no device, the fence is only seen as
+// values
+class DescriptorRing
+{
+public:
+  static constexpr uint32_t kInvalidOffset = UINT32_MAX;
+
+  explicit DescriptorRing(uint32_t capacity) : capacity{capacity} {}
+
+  // Offset of `count` consecutive slots, kInvalidOffset when they do not fit before the oldest
+  // slot still in use
+  uint32_t Allocate(uint32_t count);
+
+  // Reclaims completed frames first and, while `count` slots still do not fit, blocks on the oldest
+  // pending frame. FenceType provides CompletedValue() and WaitForValue(value) like FrameSync's.
+  // kInvalidOffset only when the current frame alone, retained slots included, leaves no room
+  template<typename FenceType>
+  uint32_t Allocate(uint32_t count, FenceType& fence)
+  {
+    Reclaim(fence.CompletedValue());
+    uint32_t offset = Allocate(count);
+    while (offset == kInvalidOffset && !pendingFrames.empty()) {
+      fence.WaitForValue(pendingFrames.front().fenceValue);
+      Reclaim(fence.CompletedValue());
+      offset = Allocate(count);
+    }
+    return offset;
+  }
+
+  // Tags slots allocated since the previous call with the fence value the GPU signals once it
+  // finished reading them
+  void FinishFrame(uint64_t fenceValue);
+
+  // Returns the slots of frames whose fence value is at most `completedValue`
+  void Reclaim(uint64_t completedValue);
+
+  // Keeps the slots from `offset` of the current lap on from being reclaimed before the current
+  // frame. False when they were reclaimed already and may be overwritten, or when they are not
+  // among the latest capacity / 2 allocated slots, so retained slots never keep a frame from
+  // allocating half the ring
+  bool Retain(uint32_t offset);
+
+  // Times allocation went back to the start of the heap. Offsets of different laps are different
+  // slots in time even when equal
+  uint64_t Lap() const { return lapStart / capacity; }
+
+  uint32_t Capacity() const { return capacity; }
+
+  // Slots not yet reclaimed, including skipped ones
+  uint32_t UsedCount() const { return static_cast<uint32_t>(head - tail); }
+  size_t PendingFrameCount() const { return pendingFrames.size(); }
+
+private:
+  static constexpr uint64_t kNothingRetained = UINT64_MAX;
+
+  struct PendingFrame {
+    uint64_t fenceValue;
+    uint64_t end;       // Allocation position after the frame
+    uint64_t retained;  // Oldest position retained by the frame
+  };
+
+  // Positions count slots since construction, the slot is position % capacity
+  uint32_t capacity = 0;
+  uint64_t head = 0;        // Next position to allocate
+  uint64_t tail = 0;        // Oldest position in use
+  uint64_t lapStart = 0;    // Position of offset 0 in the lap of the latest allocation
+  uint64_t frameStart = 0;  // Head when the current frame began
+  uint64_t currentFrameRetained = kNothingRetained;
+  std::deque<PendingFrame> pendingFrames;
+};
+
+}  // namespace dxh
@@ -20,8 +20,24 @@ public:
 
   void Register(const std::shared_ptr<Buffer>& resource)
   {
-    entries[resource.get()].resource = resource;
-    device.CreateCBV(*resource, cbvSrvUavPool.Allocate());
+    if (entries.count(resource.get())) {
+      return;
+    }
+    Entry& entry = entries[resource.get()];
+    entry.resource = resource;
+    entry.cbv = cbvSrvUavPool.Allocate();
+    device.CreateCBV(*resource, entry.cbv);
+  }
+
+  // Releases the buffer and returns its CBV slot to the pool
+  void Unregister(const Buffer* resource)
+  {
+    auto it = entries.find(resource);
+    if (it == entries.end()) {
+      return;
+    }
+    cbvSrvUavPool.Free(it->second.cbv);
+    entries.erase(it);
   }
 
   std::shared_ptr<Buffer> Find(const Buffer* resource)
@@ -23,11 +23,12 @@ Shader::Shader(
   const std::wstring& path,
   const char* entryPoint,
   UINT compileFlags,
-  const char* target
+  const char* target,
+  const D3D_SHADER_MACRO* defines
 )
 {
   D3DCompileFromFile(
-    path.c_str(), nullptr, nullptr, entryPoint, target, compileFlags, 0, blob_.GetAddressOf(),
+    path.c_str(), defines, nullptr, entryPoint, target, compileFlags, 0, blob_.GetAddressOf(),
     error.GetAddressOf()
   );
   if (error) {
@@ -9,11 +9,13 @@ namespace dxh
 class Shader
 {
 public:
+  // `defines` is a null-terminated array of preprocessor macros, or null
   explicit Shader(
     const std::wstring& path,
     const char* entryPoint,
     UINT compileFlags,
-    const char* target
+    const char* target,
+    const D3D_SHADER_MACRO* defines = nullptr
   );
 
   D3D12_SHADER_BYTECODE ByteCode() const;
@@ -27,8 +29,13 @@ private:
 class VertexShader : public Shader
 {
 public:
-  explicit VertexShader(const std::wstring& path, const char* entryPoint, UINT compileFlags)
-      : Shader{path, entryPoint, compileFlags, "vs_5_0"}
+  explicit VertexShader(
+    const std::wstring& path,
+    const char* entryPoint,
+    UINT compileFlags,
+    const D3D_SHADER_MACRO* defines = nullptr
+  )
+      : Shader{path, entryPoint, compileFlags, "vs_5_0", defines}
   {
   }
 };
@@ -36,8 +43,13 @@ public:
 class PixelShader : public Shader
 {
 public:
-  explicit PixelShader(const std::wstring& path, const char* entryPoint, UINT compileFlags)
-      : Shader{path, entryPoint, compileFlags, "ps_5_0"}
+  explicit PixelShader(
+    const std::wstring& path,
+    const char* entryPoint,
+    UINT compileFlags,
+    const D3D_SHADER_MACRO* defines = nullptr
+  )
+      : Shader{path, entryPoint, compileFlags, "ps_5_0", defines}
   {
   }
 };
@@ -0,0 +1,159 @@
+#include "JobSystem.h"
+
+namespace dxh
+{
+
+namespace
+{
+
+// Participant slot of the current thread in the pool it works for
+thread_local const JobSystem* t_jobSystem = nullptr;
+thread_local size_t t_slot = 0;
+
+}  // namespace
+
+JobSystem::JobSystem(size_t workerCount)
+{
+  if (workerCount == 0) {
+    size_t hardwareThreads = std::thread::hardware_concurrency();
+    workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+  }
+
+  queues.reserve(workerCount + 1);
+  for (size_t i = 0; i < workerCount + 1; ++i) {
+    queues.push_back(std::make_unique<WorkQueue>());
+  }
+
+  workers.reserve(workerCount);
+  for (size_t i = 0; i < workerCount; ++i) {
+    workers.emplace_back([this, slot = i + 1]() { WorkerLoop(slot); });
+  }
+}
+
+JobSystem::~JobSystem()
+{
+  {
+    std::lock_guard<std::mutex> lock{sleepMutex};
+    stopping = true;
+  }
+  wakeUp.notify_all();
+  for (auto& worker : workers) {
+    worker.join();
+  }
+}
+
+JobSystem& JobSystem::Shared()
+{
+  static JobSystem jobSystem;
+  return jobSystem;
+}
+
+void JobSystem::AttachCallingThread()
+{
+  t_jobSystem = this;
+  t_slot = 0;
+}
+
+size_t JobSystem::CurrentSlot() const
+{
+  return t_jobSystem == this ? t_slot : 0;
+}
+
+void JobSystem::Submit(TaskGroup& group, std::function<void()> task)
+{
+  group.pending.fetch_add(1, std::memory_order_relaxed);
+  {
+    WorkQueue& queue = *queues[CurrentSlot()];
+    std::lock_guard<std::mutex> lock{queue.mutex};
+    queue.tasks.push_back({std::move(task), &group});
+  }
+  queuedCount.fetch_add(1, std::memory_order_release);
+
+  // Taking the lock orders the count update with a worker checking it before it sleeps
+  { std::lock_guard<std::mutex> lock{sleepMutex}; }
+  wakeUp.notify_one();
+}
+
+void JobSystem::Wait(TaskGroup& group)
+{
+  size_t slot = CurrentSlot();
+  while (!group.Done()) {
+    if (TryRunOne(slot)) {
+      continue;
+    }
+    // Nothing left to run or steal, the remaining tasks of `group` are running elsewhere. Sleep
+    // until the last of them finishes or new tasks are queued, these may be nested in `group`
+    std::unique_lock<std::mutex> lock{sleepMutex};
+    wakeUp.wait(lock, [this, &group]() {
+      return group.Done() || queuedCount.load(std::memory_order_acquire) > 0;
+    });
+  }
+}
+
+bool JobSystem::PopOwn(size_t slot, Task& task)
+{
+  WorkQueue& queue = *queues[slot];
+  std::lock_guard<std::mutex> lock{queue.mutex};
+  if (queue.tasks.empty()) {
+    return false;
+  }
+  task = std::move(queue.tasks.back());
+  queue.tasks.pop_back();
+  return true;
+}
+
+bool JobSystem::Steal(size_t thief, Task& task)
+{
+  size_t queueCount = queues.size();
+  for (size_t offset = 1; offset < queueCount; ++offset) {
+    WorkQueue& queue = *queues[(thief + offset) % queueCount];
+    std::lock_guard<std::mutex> lock{queue.mutex};
+    if (!queue.tasks.empty()) {
+      task = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
+
+bool JobSystem::TryRunOne(size_t slot)
+{
+  Task task;
+  if (!PopOwn(slot, task) && !Steal(slot, task)) {
+    return false;
+  }
+  queuedCount.fetch_sub(1, std::memory_order_relaxed);
+  Run(task);
+  return true;
+}
+
+void JobSystem::Run(Task& task)
+{
+  task.func();
+  if (task.group->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    // Waiters of the group share the condition variable with idle workers. The group may be gone
+    // once pending reaches 0, so only the pool is touched from here on
+    { std::lock_guard<std::mutex> lock{sleepMutex}; }
+    wakeUp.notify_all();
+  }
+}
+
+void JobSystem::WorkerLoop(size_t slot)
+{
+  t_jobSystem = this;
+  t_slot = slot;
+
+  while (!stopping.load(std::memory_order_relaxed)) {
+    if (TryRunOne(slot)) {
+      continue;
+    }
+    std::unique_lock<std::mutex> lock{sleepMutex};
+    wakeUp.wait(lock, [this]() {
+      return stopping.load(std::memory_order_relaxed) ||
+             queuedCount.load(std::memory_order_acquire) > 0;
+    });
+  }
+}
+
+}  // namespace dxh
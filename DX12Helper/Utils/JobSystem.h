@@ -0,0 +1,177 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dxh
+{
+
+class JobSystem;
+
+// Tasks submitted together, JobSystem::Wait returns once every one of them finished
+class TaskGroup
+{
+public:
+  TaskGroup() = default;
+  TaskGroup(const TaskGroup&) = delete;
+  TaskGroup& operator=(const TaskGroup&) = delete;
+
+  bool Done() const { return pending.load(std::memory_order_acquire) == 0; }
+
+private:
+  friend class JobSystem;
+  std::atomic<size_t> pending{0};
+};
+
+// Work-stealing thread pool. Every participant owns a deque, it pushes and pops its own tasks at
+// the back while idle participants steal from the front of the others. Slot 0 belongs to the
+// thread attached with AttachCallingThread, usually the render thread, and takes tasks submitted
+// by threads outside the pool. Waiting threads run queued tasks and only block once none are left,
+// so tasks may submit and wait on nested groups
+class JobSystem
+{
+public:
+  // 0 starts one worker per hardware thread besides the calling one
+  explicit JobSystem(size_t workerCount = 0);
+  ~JobSystem();
+
+  JobSystem(const JobSystem&) = delete;
+  JobSystem& operator=(const JobSystem&) = delete;
+
+  // Pool shared by the whole process, created on first use
+  static JobSystem& Shared();
+
+  // Makes the calling thread participant 0, tasks it submits stay in its deque until it runs them
+  // or a worker steals them. One thread at a time can be attached
+  void AttachCallingThread();
+
+  size_t WorkerCount() const { return workers.size(); }
+
+  // Worker threads plus the attached thread
+  size_t ParticipantCount() const { return workers.size() + 1; }
+
+  void Submit(TaskGroup& group, std::function<void()> task);
+
+  // Runs queued tasks on the calling thread until every task of `group` finished, sleeps while the
+  // last ones run on other threads
+  void Wait(TaskGroup& group);
+
+  // Calls func(begin, end) over disjoint subranges covering [first, last). Ranges are halved
+  // recursively down to a grain of about count / (8 * ParticipantCount()), never below
+  // `minGrain`, so idle participants steal the larger halves first. With `maxParticipants` below
+  // ParticipantCount(), that many runners instead take grains of count / (8 * maxParticipants)
+  // from a shared cursor, so at most `maxParticipants` threads run func at once. 0 allows all
+  template<typename RangeFunc>
+  void ParallelFor(
+    size_t first,
+    size_t last,
+    RangeFunc func,
+    size_t minGrain = 1,
+    size_t maxParticipants = 0
+  );
+
+private:
+  struct Task {
+    std::function<void()> func;
+    TaskGroup* group = nullptr;
+  };
+
+  struct WorkQueue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  size_t CurrentSlot() const;
+  bool PopOwn(size_t slot, Task& task);
+  bool Steal(size_t thief, Task& task);
+  bool TryRunOne(size_t slot);
+  void Run(Task& task);
+  void WorkerLoop(size_t slot);
+
+  template<typename RangeFunc>
+  void SplitRange(TaskGroup& group, size_t first, size_t last, size_t grain, RangeFunc& func);
+
+  std::vector<std::unique_ptr<WorkQueue>> queues;  // One per participant, slot 0 is attached
+  std::vector<std::thread> workers;
+
+  std::mutex sleepMutex;
+  std::condition_variable wakeUp;
+  std::atomic<size_t> queuedCount{0};
+  std::atomic<bool> stopping{false};
+};
+
+template<typename RangeFunc>
+void JobSystem::SplitRange(
+  TaskGroup& group,
+  size_t first,
+  size_t last,
+  size_t grain,
+  RangeFunc& func
+)
+{
+  // Keeps the lower half and hands the upper one to thieves
+  while (last - first > grain) {
+    size_t middle = first + (last - first) / 2;
+    Submit(group, [this, &group, middle, last, grain, &func]() {
+      SplitRange(group, middle, last, grain, func);
+    });
+    last = middle;
+  }
+  func(first, last);
+}
+
+template<typename RangeFunc>
+void JobSystem::ParallelFor(
+  size_t first,
+  size_t last,
+  RangeFunc func,
+  size_t minGrain,
+  size_t maxParticipants
+)
+{
+  if (first >= last) {
+    return;
+  }
+  size_t participantCount = ParticipantCount();
+  bool capped = maxParticipants > 0 && maxParticipants < participantCount;
+  if (capped) {
+    participantCount = maxParticipants;
+  }
+  size_t count = last - first;
+  size_t grain = std::max<size_t>({minGrain, 1, count / (8 * participantCount)});
+  if (count <= grain || participantCount == 1) {
+    func(first, last);
+    return;
+  }
+
+  TaskGroup group;
+  if (!capped) {
+    SplitRange(group, first, last, grain, func);
+    Wait(group);
+    return;
+  }
+
+  // Fewer runners than participants, each takes the next grain until the range is used up
+  std::atomic<size_t> cursor{first};
+  auto runGrains = [&]() {
+    for (size_t begin = cursor.fetch_add(grain); begin < last; begin = cursor.fetch_add(grain)) {
+      func(begin, std::min(begin + grain, last));
+    }
+  };
+  size_t runnerCount = std::min(participantCount, (count + grain - 1) / grain);
+  for (size_t runner = 1; runner < runnerCount; ++runner) {
+    Submit(group, runGrains);
+  }
+  runGrains();
+  Wait(group);
+}
+
+}  // namespace dxh
@@ -0,0 +1,119 @@
+#include "MappedFile.h"
+
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace dxh
+{
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : data{std::exchange(other.data, nullptr)}, size{std::exchange(other.size, 0)}
+{
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+  if (this != &other) {
+    Close();
+    data = std::exchange(other.data, nullptr);
+    size = std::exchange(other.size, 0);
+  }
+  return *this;
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const std::string& path)
+{
+  Close();
+
+  HANDLE file = CreateFileA(
+    path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+    nullptr
+  );
+  if (file == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+
+  LARGE_INTEGER fileSize{};
+  if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+    CloseHandle(file);
+    return false;
+  }
+
+  // The view keeps the mapping and the file open, both handles can go right away
+  HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  CloseHandle(file);
+  if (mapping == nullptr) {
+    return false;
+  }
+  void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(mapping);
+  if (view == nullptr) {
+    return false;
+  }
+
+  data = view;
+  size = static_cast<size_t>(fileSize.QuadPart);
+  return true;
+}
+
+void MappedFile::Close()
+{
+  if (data != nullptr) {
+    UnmapViewOfFile(data);
+  }
+  data = nullptr;
+  size = 0;
+}
+
+#else
+
+bool MappedFile::Open(const std::string& path)
+{
+  Close();
+
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+
+  struct stat fileStat{};
+  if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0) {
+    close(fd);
+    return false;
+  }
+
+  // The mapping keeps the file open, the descriptor can go right away
+  size_t fileSize = static_cast<size_t>(fileStat.st_size);
+  void* view = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (view == MAP_FAILED) {
+    return false;
+  }
+
+  data = view;
+  size = fileSize;
+  return true;
+}
+
+void MappedFile::Close()
+{
+  if (data != nullptr) {
+    munmap(const_cast<void*>(data), size);
+  }
+  data = nullptr;
+  size = 0;
+}
+
+#endif
+
+}  // namespace dxh
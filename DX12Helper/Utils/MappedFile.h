@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace dxh
+{
+
+// Read-only memory mapping of a whole file, pages are loaded on first access
+class MappedFile
+{
+public:
+  MappedFile() = default;
+  ~MappedFile() { Close(); }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  MappedFile(MappedFile&& other) noexcept;
+  MappedFile& operator=(MappedFile&& other) noexcept;
+
+  // Maps `path`, closing the previous mapping first. False when the file is missing, empty or
+  // cannot be mapped
+  bool Open(const std::string& path);
+  void Close();
+
+  bool IsOpen() const { return data != nullptr; }
+  const void* Data() const { return data; }
+  size_t Size() const { return size; }
+
+private:
+  const void* data = nullptr;
+  size_t size = 0;
+};
+
+}  // namespace dxh
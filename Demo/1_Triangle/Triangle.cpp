@@ -106,7 +106,9 @@ int WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow)
 
   dxh::RootSignature rs{device.Get(), 2, rootParameters};
 
-  dxh::DynamicDescriptorHeap dynamicHeap{device.Get(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV};
+  dxh::DynamicDescriptorHeap dynamicHeap{
+    device.Get(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, *rc.queueFence
+  };
 
   dynamicHeap.ParseRootSignature(rs);
   dynamicHeap.SetDescriptors(1, 0, 1, &cbv);
@@ -190,6 +192,7 @@ int WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow)
     rc.CloseAndExecute(cmdList);
 
     rc.FlushCommandQueue();
+    dynamicHeap.FinishFrame(rc.queueFence->CompletedValue());
     rc.Present();
   }
 }
@@ -101,7 +101,7 @@ int WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow)
   dxh::RootSignature rs{rc.device->Get(), 1, rootParams};
 
   dxh::DynamicDescriptorHeap dynamicDescriptorHeap{
-    rc.device->Get(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV
+    rc.device->Get(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, *rc.queueFence
   };
 
   dynamicDescriptorHeap.ParseRootSignature(rs);
@@ -180,6 +180,7 @@ int WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow)
     rc.PrepareSwapChainForPresent(cmdList);
     rc.CloseAndExecute(cmdList);
     rc.FlushCommandQueue();
+    dynamicDescriptorHeap.FinishFrame(rc.queueFence->CompletedValue());
     rc.Present();
   }
 }
@@ -0,0 +1,419 @@
+// Headless benchmark of instance update, culling and upload gather. Runs the culling code of the
+// demo without a window or GPU along a scripted camera path and prints per-stage timing
+// percentiles as JSON
+//
+// Usage: DemoInstancingBenchmark [--counts 100000,1000000,10000000]
+//          [--accelerations none,octree,grid]
+//          [--space world|worldpacket|worldparallel|local|localparallel] [--path orbit|flyover]
+//          [--frames 120] [--warmup 10] [--static] [--no-occlusion] [--no-lod]
+//          [--format full|affine|quat] [--snapshots dir] [--out result.json]
+//
+// With --snapshots, the scene of each instance count is mapped from dir/instances_<count>.scene,
+// which is written on the first run
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Camera.h"
+#include "InstanceFormats.h"
+#include "Instances.h"
+#include "JobSystem.h"
+
+using namespace DirectX;
+
+namespace
+{
+
+enum class CameraPath : uint8_t { Orbit, Flyover };
+
+// Acceleration selected on the command line, the octree is dynamic when instances move
+enum class AccelerationKind : uint8_t { None, Octree, LinearOctree, BVH, UniformGrid };
+
+struct BenchmarkConfig {
+  std::vector<size_t> instanceCounts = {100'000, 1'000'000, 10'000'000};
+  std::vector<AccelerationKind> accelerations = {
+    AccelerationKind::None, AccelerationKind::Octree, AccelerationKind::LinearOctree,
+    AccelerationKind::BVH, AccelerationKind::UniformGrid
+  };
+  FrustumCullingSpace space = FrustumCullingSpace::WorldParallel;
+  CameraPath path = CameraPath::Orbit;
+  size_t frameCount = 120;
+  size_t warmupFrameCount = 10;
+  bool moving = true;
+  std::string snapshotDir;  // Scenes are generated when empty
+  std::string outputPath;   // stdout when empty
+};
+
+// Simulated frame time, instances and camera advance by this much per frame
+constexpr float kFrameTime = 1.f / 60.f;
+
+struct NamedValue {
+  const char* name;
+  uint8_t value;
+};
+
+const NamedValue kAccelerationNames[] = {
+  {"none", static_cast<uint8_t>(AccelerationKind::None)},
+  {"octree", static_cast<uint8_t>(AccelerationKind::Octree)},
+  {"linear", static_cast<uint8_t>(AccelerationKind::LinearOctree)},
+  {"bvh", static_cast<uint8_t>(AccelerationKind::BVH)},
+  {"grid", static_cast<uint8_t>(AccelerationKind::UniformGrid)}
+};
+
+const NamedValue kSpaceNames[] = {
+  {"world", static_cast<uint8_t>(FrustumCullingSpace::World)},
+  {"worldpacket", static_cast<uint8_t>(FrustumCullingSpace::WorldPacket)},
+  {"worldparallel", static_cast<uint8_t>(FrustumCullingSpace::WorldParallel)},
+  {"local", static_cast<uint8_t>(FrustumCullingSpace::Local)},
+  {"localparallel", static_cast<uint8_t>(FrustumCullingSpace::LocalParallel)}
+};
+
+const NamedValue kPathNames[] = {
+  {"orbit", static_cast<uint8_t>(CameraPath::Orbit)},
+  {"flyover", static_cast<uint8_t>(CameraPath::Flyover)}
+};
+
+const NamedValue kFormatNames[] = {
+  {"full", static_cast<uint8_t>(InstanceFormat::Full)},
+  {"affine", static_cast<uint8_t>(InstanceFormat::Affine)},
+  {"quat", static_cast<uint8_t>(InstanceFormat::QuatPosScale)}
+};
+
+template<size_t count>
+bool ParseName(const NamedValue (&names)[count], const std::string& str, uint8_t& value)
+{
+  for (const NamedValue& name : names) {
+    if (str == name.name) {
+      value = name.value;
+      return true;
+    }
+  }
+  return false;
+}
+
+template<size_t count>
+const char* NameOf(const NamedValue (&names)[count], uint8_t value)
+{
+  for (const NamedValue& name : names) {
+    if (name.value == value) {
+      return name.name;
+    }
+  }
+  return "unknown";
+}
+
+std::vector<std::string> SplitList(const std::string& list)
+{
+  std::vector<std::string> items;
+  std::istringstream stream{list};
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    if (!item.empty()) {
+      items.push_back(item);
+    }
+  }
+  return items;
+}
+
+bool ParseArguments(int argc, char** argv, BenchmarkConfig& config)
+{
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    std::string value = hasValue ? argv[i + 1] : "";
+    uint8_t parsed = 0;
+
+    if (arg == "--static") {
+      config.moving = false;
+    } else if (arg == "--no-occlusion") {
+      g_enableOcclusionCulling = false;
+    } else if (arg == "--no-lod") {
+      g_enableLodSelection = false;
+    } else if (!hasValue) {
+      std::cerr << "Missing value or unknown option: " << arg << "\n";
+      return false;
+    } else if (arg == "--counts") {
+      config.instanceCounts.clear();
+      for (const std::string& count : SplitList(value)) {
+        config.instanceCounts.push_back(std::stoull(count));
+      }
+      ++i;
+    } else if (arg == "--accelerations") {
+      config.accelerations.clear();
+      for (const std::string& name : SplitList(value)) {
+        if (!ParseName(kAccelerationNames, name, parsed)) {
+          std::cerr << "Unknown acceleration: " << name << "\n";
+          return false;
+        }
+        config.accelerations.push_back(static_cast<AccelerationKind>(parsed));
+      }
+      ++i;
+    } else if (arg == "--space" && ParseName(kSpaceNames, value, parsed)) {
+      config.space = static_cast<FrustumCullingSpace>(parsed);
+      ++i;
+    } else if (arg == "--path" && ParseName(kPathNames, value, parsed)) {
+      config.path = static_cast<CameraPath>(parsed);
+      ++i;
+    } else if (arg == "--format" && ParseName(kFormatNames, value, parsed)) {
+      g_instanceFormat = static_cast<InstanceFormat>(parsed);
+      ++i;
+    } else if (arg == "--frames") {
+      config.frameCount = std::stoull(value);
+      ++i;
+    } else if (arg == "--warmup") {
+      config.warmupFrameCount = std::stoull(value);
+      ++i;
+    } else if (arg == "--snapshots") {
+      config.snapshotDir = value;
+      ++i;
+    } else if (arg == "--out") {
+      config.outputPath = value;
+      ++i;
+    } else {
+      std::cerr << "Invalid option: " << arg << " " << value << "\n";
+      return false;
+    }
+  }
+  return !config.instanceCounts.empty() && !config.accelerations.empty() &&
+         config.frameCount > 0;
+}
+
+CullingAcceleration ToCullingAcceleration(AccelerationKind kind, bool moving)
+{
+  switch (kind) {
+    case AccelerationKind::Octree:
+      return moving ? CullingAcceleration::DynamicOctree : CullingAcceleration::StaticOctree;
+    case AccelerationKind::LinearOctree:
+      return CullingAcceleration::LinearOctree;
+    case AccelerationKind::BVH:
+      return CullingAcceleration::BVH;
+    case AccelerationKind::UniformGrid:
+      return CullingAcceleration::UniformGrid;
+    default:
+      return CullingAcceleration::None;
+  }
+}
+
+// Camera of the demo window at `progress` (0 to 1) along the path. The field is 2.5 units per
+// instance wide, the orbit circles its center like the demo and the flyover crosses most of it
+dxh::PerspectiveCamera PathCamera(CameraPath path, float progress, size_t instanceCount)
+{
+  dxh::PerspectiveCamera cam;
+  cam.aspectRatio = 800.f / 600.f;
+  cam.up = {0.f, 1.f, 0.f};
+
+  if (path == CameraPath::Flyover) {
+    float fieldSize = 2.5f * std::sqrt(static_cast<float>(instanceCount));
+    float x = (progress - 0.5f) * 0.8f * fieldSize;
+    float z = 0.1f * fieldSize;
+    cam.position = {x, 15.f, z};
+    cam.lookAt = {x + 10.f, 5.f, z + 2.f};
+  } else {
+    float angle = XM_2PI * progress;
+    cam.position = {40.f * std::cos(angle), 10.f, 40.f * std::sin(angle)};
+    cam.lookAt = {0.f, 0.f, 0.f};
+  }
+  return cam;
+}
+
+// Frame samples of one stage in milliseconds
+struct StageSamples {
+  const char* name;
+  std::vector<double> samples;
+};
+
+struct RunResult {
+  size_t instanceCount = 0;
+  double sceneSetupMs = 0.0;  // Generating or loading the scene, before the first frame
+  bool sceneFromSnapshot = false;
+  CullingAcceleration acceleration = CullingAcceleration::None;
+  std::vector<size_t> visibleCounts;
+  std::vector<StageSamples> stages;
+};
+
+// Nearest-rank percentile of sorted samples
+template<typename T>
+T Percentile(const std::vector<T>& sorted, double percent)
+{
+  size_t rank = static_cast<size_t>(std::ceil(percent / 100.0 * sorted.size()));
+  return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+}
+
+double ElapsedMs(std::chrono::steady_clock::time_point start)
+{
+  std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+RunResult RunBenchmark(const BenchmarkConfig& config, size_t instanceCount, AccelerationKind kind)
+{
+  RunResult result;
+  result.instanceCount = instanceCount;
+  result.acceleration = ToCullingAcceleration(kind, config.moving);
+  result.stages = {{"update", {}},     {"accelerationUpdate", {}}, {"traversal", {}},
+                   {"perObject", {}},  {"occlusion", {}},          {"lod", {}},
+                   {"uploadGather", {}}, {"total", {}}};
+
+  // The first frame of every run builds its acceleration structure unless the scene snapshot
+  // provided it, warmup frames absorb it
+  g_octreeBuilt = false;
+
+  std::vector<uint8_t> uploadBuffer(instanceCount * InstanceFormatStride(g_instanceFormat));
+  size_t totalFrameCount = config.warmupFrameCount + config.frameCount;
+  for (size_t frame = 0; frame < totalFrameCount; ++frame) {
+    float progress = static_cast<float>(frame) / static_cast<float>(totalFrameCount);
+    dxh::PerspectiveCamera cam = PathCamera(config.path, progress, instanceCount);
+
+    double updateMs = 0.0;
+    if (config.moving) {
+      auto start = std::chrono::steady_clock::now();
+      UpdateInstances(static_cast<float>(frame + 1) * kFrameTime);
+      updateMs = ElapsedMs(start);
+    }
+
+    CullInstances(cam, config.space, result.acceleration);
+
+    auto gatherStart = std::chrono::steady_clock::now();
+    PackInstances(
+      g_instanceFormat, g_instanceBuffer.data(), g_culledInstanceIndices.data(),
+      g_culledInstanceIndices.size(), uploadBuffer.data()
+    );
+    double gatherMs = ElapsedMs(gatherStart);
+
+    if (frame < config.warmupFrameCount) {
+      continue;
+    }
+    const CullTimings& t = g_cullTimings;
+    double stageMs[] = {updateMs,           t.accelerationUpdate / 1000.0, t.traversal / 1000.0,
+                        t.perObject / 1000.0, t.occlusion / 1000.0,        t.lod / 1000.0,
+                        gatherMs};
+    double totalMs = 0.0;
+    for (size_t stage = 0; stage < std::size(stageMs); ++stage) {
+      result.stages[stage].samples.push_back(stageMs[stage]);
+      totalMs += stageMs[stage];
+    }
+    result.stages.back().samples.push_back(totalMs);
+    result.visibleCounts.push_back(g_culledInstanceIndices.size());
+  }
+  return result;
+}
+
+const char* AccelerationName(CullingAcceleration acceleration)
+{
+  switch (acceleration) {
+    case CullingAcceleration::StaticOctree:
+      return "StaticOctree";
+    case CullingAcceleration::DynamicOctree:
+      return "DynamicOctree";
+    case CullingAcceleration::LinearOctree:
+      return "LinearOctree";
+    case CullingAcceleration::BVH:
+      return "BVH";
+    case CullingAcceleration::UniformGrid:
+      return "UniformGrid";
+    default:
+      return "None";
+  }
+}
+
+void WriteJson(std::ostream& out, const BenchmarkConfig& config, const std::vector<RunResult>& runs)
+{
+  out << std::fixed << std::setprecision(4);
+  out << "{\n";
+  out << "  \"config\": {\n";
+  out << "    \"frames\": " << config.frameCount << ",\n";
+  out << "    \"warmupFrames\": " << config.warmupFrameCount << ",\n";
+  out << "    \"path\": \"" << NameOf(kPathNames, static_cast<uint8_t>(config.path)) << "\",\n";
+  out << "    \"space\": \"" << NameOf(kSpaceNames, static_cast<uint8_t>(config.space)) << "\",\n";
+  out << "    \"moving\": " << (config.moving ? "true" : "false") << ",\n";
+  out << "    \"occlusion\": " << (g_enableOcclusionCulling ? "true" : "false") << ",\n";
+  out << "    \"lod\": " << (g_enableLodSelection ? "true" : "false") << ",\n";
+  out << "    \"instanceFormat\": \"" << InstanceFormatName(g_instanceFormat) << "\",\n";
+  out << "    \"threads\": " << dxh::JobSystem::Shared().ParticipantCount() << "\n";
+  out << "  },\n";
+  out << "  \"runs\": [\n";
+  for (size_t r = 0; r < runs.size(); ++r) {
+    const RunResult& run = runs[r];
+    std::vector<size_t> visible = run.visibleCounts;
+    std::sort(visible.begin(), visible.end());
+
+    out << "    {\n";
+    out << "      \"instances\": " << run.instanceCount << ",\n";
+    out << "      \"acceleration\": \"" << AccelerationName(run.acceleration) << "\",\n";
+    out << "      \"sceneSetupMs\": " << run.sceneSetupMs << ",\n";
+    out << "      \"sceneFromSnapshot\": " << (run.sceneFromSnapshot ? "true" : "false") << ",\n";
+    out << "      \"visibleP50\": " << Percentile(visible, 50.0) << ",\n";
+    out << "      \"stagesMs\": {\n";
+    for (size_t s = 0; s < run.stages.size(); ++s) {
+      std::vector<double> sorted = run.stages[s].samples;
+      std::sort(sorted.begin(), sorted.end());
+      double mean = std::accumulate(sorted.begin(), sorted.end(), 0.0) / sorted.size();
+      out << "        \"" << run.stages[s].name << "\": {";
+      out << "\"p50\": " << Percentile(sorted, 50.0) << ", ";
+      out << "\"p95\": " << Percentile(sorted, 95.0) << ", ";
+      out << "\"p99\": " << Percentile(sorted, 99.0) << ", ";
+      out << "\"mean\": " << mean << "}";
+      out << (s + 1 < run.stages.size() ? ",\n" : "\n");
+    }
+    out << "      }\n";
+    out << "    }" << (r + 1 < runs.size() ? ",\n" : "\n");
+  }
+  out << "  ]\n";
+  out << "}\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  BenchmarkConfig config;
+  if (!ParseArguments(argc, argv, config)) {
+    std::cerr << "See the top of Benchmark.cpp for the options\n";
+    return 1;
+  }
+  dxh::JobSystem::Shared().AttachCallingThread();
+
+  std::vector<RunResult> runs;
+  for (size_t instanceCount : config.instanceCounts) {
+    auto setupStart = std::chrono::steady_clock::now();
+    std::string snapshotPath;
+    bool fromSnapshot = false;
+    if (!config.snapshotDir.empty()) {
+      snapshotPath = config.snapshotDir + "/instances_" + std::to_string(instanceCount) + ".scene";
+      fromSnapshot = LoadSceneSnapshot(snapshotPath, instanceCount);
+    }
+    if (!fromSnapshot) {
+      ResetInstances(instanceCount);
+      UpdateInstances(0.f);
+    }
+    double setupMs = ElapsedMs(setupStart);
+    if (!snapshotPath.empty() && !fromSnapshot && !SaveSceneSnapshot(snapshotPath)) {
+      std::cerr << "Failed to write " << snapshotPath << "\n";
+    }
+
+    for (AccelerationKind kind : config.accelerations) {
+      runs.push_back(RunBenchmark(config, instanceCount, kind));
+      runs.back().sceneSetupMs = setupMs;
+      runs.back().sceneFromSnapshot = fromSnapshot;
+      std::cerr << "Done: " << instanceCount << " instances, "
+                << AccelerationName(runs.back().acceleration) << "\n";
+    }
+  }
+
+  if (config.outputPath.empty()) {
+    WriteJson(std::cout, config, runs);
+  } else {
+    std::ofstream file{config.outputPath};
+    WriteJson(file, config, runs);
+  }
+  return 0;
+}
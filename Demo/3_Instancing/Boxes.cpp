@@ -1,4 +1,5 @@
 #include <iomanip>
+#include <iterator>
 #include <sstream>
 
 #include "AutoTimer.h"
@@ -10,7 +11,9 @@
 #include "Device.h"
 #include "Fence.h"
 #include "GeometryRender.h"
+#include "InstanceFormats.h"
 #include "Instances.h"
+#include "JobSystem.h"
 #include "MeshFactory.h"
 #include "PCH.h"
 #include "RenderContext.h"
@@ -38,6 +41,39 @@ struct ConstantBufferData {
 
 using Vertex = dxh::SimpleVertex;
 
+// Upload buffers rewritten every frame, one set per frame in flight so the CPU fills frame N + 1
+// while the GPU still reads frame N
+struct FrameResources {
+  std::unique_ptr<dxh::ConstantBuffer<ConstantBufferData>> constantBuffer;
+  D3D12_CPU_DESCRIPTOR_HANDLE cbv;
+
+  std::unique_ptr<dxh::UploadHeapBuffer> instanceBuffer;
+  D3D12_CPU_DESCRIPTOR_HANDLE instanceSRV;
+  InstanceFormat instanceFormat = InstanceFormat::Full;
+  size_t sceneVersion = 0;  // Scene held in scene order by instanceBuffer, 0 if none
+
+  std::unique_ptr<dxh::UploadHeapArray<uint32_t>> visibleIndexBuffer;
+  D3D12_CPU_DESCRIPTOR_HANDLE visibleIndexSRV;
+};
+
+// Instances are packed in `format`, the buffer is recreated when the format changes. Its SRV is
+// rewritten in place, so copies of tables holding it are invalidated
+void CreateInstanceBuffer(
+  dxh::RenderContext& rc,
+  dxh::DynamicDescriptorHeap& descriptorHeap,
+  FrameResources& frame,
+  InstanceFormat format
+)
+{
+  size_t stride = InstanceFormatStride(format);
+  frame.instanceBuffer =
+    std::make_unique<dxh::UploadHeapBuffer>(rc.device->Get(), g_instanceCount * stride);
+  rc.device->CreateSRV(*frame.instanceBuffer, stride, frame.instanceSRV);
+  descriptorHeap.InvalidateCopiedTables();
+  frame.instanceFormat = format;
+  frame.sceneVersion = 0;
+}
+
 int g_screenWidth = 800;
 int g_screenHeight = 600;
 
@@ -45,19 +81,73 @@ bool g_enableFrustumCulling = true;
 bool g_enableOctreeCulling = true;
 bool g_tickInstances = true;
 
+// Instance data stays in scene order and is uploaded only when instances move, draws read it
+// through a per-frame list of 32-bit visible indices instead of a gathered copy
+bool g_useVisibleIndexList = true;
+
+// Instances at time 0 with their linear octree, written on the first run and mapped afterwards
+const char* g_sceneSnapshotPath = "instances.scene";
+
+// Acceleration structure used when octree culling is enabled, cycled with 'A'
+enum class AccelerationKind : uint8_t { Octree, LinearOctree, BVH, UniformGrid, Count };
+AccelerationKind g_accelerationKind = AccelerationKind::Octree;
+
+CullingAcceleration CurrentAcceleration()
+{
+  if (!g_enableOctreeCulling) {
+    return CullingAcceleration::None;
+  }
+  switch (g_accelerationKind) {
+    case AccelerationKind::LinearOctree:
+      return CullingAcceleration::LinearOctree;
+    case AccelerationKind::BVH:
+      return CullingAcceleration::BVH;
+    case AccelerationKind::UniformGrid:
+      return CullingAcceleration::UniformGrid;
+    default:
+      return g_tickInstances ? CullingAcceleration::DynamicOctree
+                             : CullingAcceleration::StaticOctree;
+  }
+}
+
 std::string GetModeString()
 {
   std::string res = g_enableFrustumCulling ? "Cull" : "NoCull";
   res += ", ";
-  if (g_enableOctreeCulling) {
-    if (g_tickInstances) {
-      res += "DynamicOctree";
-    } else {
+  switch (CurrentAcceleration()) {
+    case CullingAcceleration::StaticOctree:
       res += "StaticOctree";
-    }
-  } else {
-    res += "NoAcc";
+      break;
+    case CullingAcceleration::DynamicOctree:
+      res += "DynamicOctree";
+      break;
+    case CullingAcceleration::LinearOctree:
+      res += "LinearOctree";
+      break;
+    case CullingAcceleration::BVH:
+      res += "BVH";
+      break;
+    case CullingAcceleration::UniformGrid:
+      res += "UniformGrid";
+      break;
+    default:
+      res += "NoAcc";
+      break;
+  }
+  if (g_enableFrustumCulling && g_enableOcclusionCulling) {
+    res += ", Occlusion";
+  }
+  if (g_enableFrustumCulling && g_useTightBounds) {
+    res += ", TightBounds";
+  }
+  if (g_enableFrustumCulling && g_enableLodSelection) {
+    res += ", LOD";
+  }
+  if (g_useVisibleIndexList) {
+    res += ", IndexList";
   }
+  res += ", ";
+  res += InstanceFormatName(g_instanceFormat);
   return res;
 }
 
@@ -74,8 +164,8 @@ XMFLOAT3 g_ambientColor = {0.2f, 0.2f, 0.2f};
 
 XMFLOAT3 LightDirection(float time, float speed = 0.5f)
 {
-  float x = std::cosf(time * speed);
-  float z = std::sinf(time * speed);
+  float x = std::cos(time * speed);
+  float z = std::sin(time * speed);
   return {x, 1.0f, z};
 }
 
@@ -112,6 +202,15 @@ int WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow)
   );
   ShowWindow(hwnd, nCmdShow);
 
+  // The render thread is participant 0 of the job system that runs culling and instance updates
+  dxh::JobSystem::Shared().AttachCallingThread();
+
+  if (!LoadSceneSnapshot(g_sceneSnapshotPath, g_instanceCount)) {
+    ResetInstances(g_instanceCount);
+    UpdateInstances(0.f);
+    SaveSceneSnapshot(g_sceneSnapshotPath);
+  }
+
   // Initialize Direct3D 12
   Microsoft::WRL::ComPtr<IDXGIFactory4> factory;
   HRESULT hr = CreateDXGIFactory1(IID_PPV_ARGS(factory.ReleaseAndGetAddressOf()));
@@ -134,45 +233,64 @@ int WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow)
     dxh::CreateUnitBoxWithNormal<Vertex, uint16_t>();
   dxh::TriangleMeshRenderResource<Vertex, uint16_t> boxMesh{rc.device->Get(), &boxMeshData};
 
-  dxh::CommandAllocator cmdAlloc{rc.device->Get()};
-  dxh::GraphicsCommandList cmdList{rc.device->Get(), cmdAlloc.Get()};
+  dxh::TriangleMeshData<Vertex, uint16_t> lowBoxMeshData =
+    dxh::CreateUnitBoxWithCornerNormal<Vertex, uint16_t>();
+  dxh::TriangleMeshRenderResource<Vertex, uint16_t> lowBoxMesh{rc.device->Get(), &lowBoxMeshData};
+
+  // Mesh of each entry of g_lodPixelSizes, the last one is reused by further LODs
+  std::vector<const dxh::TriangleMeshRenderResource<Vertex, uint16_t>*> lodMeshes = {
+    &boxMesh, &lowBoxMesh
+  };
+  std::vector<size_t> lodIndexCounts = {boxMeshData.IndexCount(), lowBoxMeshData.IndexCount()};
+
+  dxh::GraphicsCommandList cmdList{rc.device->Get(), rc.CurrentFrame().cmdAlloc->Get()};
 
   boxMesh.QueueUploadMeshData(cmdList);
+  lowBoxMesh.QueueUploadMeshData(cmdList);
   rc.CloseAndExecute(cmdList);
   rc.FlushCommandQueue();
 
-  dxh::ConstantBuffer<ConstantBufferData> constantBuffer{rc.device->Get(), 1};
-  auto cbv = rc.cbvSrvUavPool.Allocate();
-  rc.device->CreateCBV(constantBuffer, cbv);
-
-  dxh::UploadHeapArray<InstanceData> instanceBuffer{rc.device->Get(), g_instanceCount};
-  auto instanceSRV = rc.cbvSrvUavPool.Allocate();
-  rc.device->CreateSRV(instanceBuffer, instanceSRV);
-
   CD3DX12_DESCRIPTOR_RANGE ranges[2];
   ranges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 0, 0);
-  ranges[1].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0, 0);
+  ranges[1].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 2, 0, 0);
 
-  CD3DX12_ROOT_PARAMETER rootParams[1];
+  CD3DX12_ROOT_PARAMETER rootParams[2];
   rootParams[0].InitAsDescriptorTable(2, ranges, D3D12_SHADER_VISIBILITY_ALL);
+  // Instance offset and visible index flag
+  rootParams[1].InitAsConstants(2, 1, 0, D3D12_SHADER_VISIBILITY_VERTEX);
 
-  dxh::RootSignature rs{rc.device->Get(), 1, rootParams};
+  dxh::RootSignature rs{rc.device->Get(), 2, rootParams};
 
-  dxh::DynamicDescriptorHeap dynamicDescriptorHeap{
-    rc.device->Get(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV
+  // Tables of every frame slot are copied into this heap, frames reclaim their copies on the fence
+  dxh::DynamicDescriptorHeap descriptorHeap{
+    rc.device->Get(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, *rc.queueFence
   };
+  descriptorHeap.ParseRootSignature(rs);
+  // Each frame slot binds the same handles every time, they are copied once per ring lap
+  descriptorHeap.EnableTableReuse(true);
+
+  std::array<FrameResources, dxh::kFramesInFlight> frameResources;
+  for (FrameResources& frame : frameResources) {
+    frame.constantBuffer =
+      std::make_unique<dxh::ConstantBuffer<ConstantBufferData>>(rc.device->Get(), 1);
+    frame.cbv = rc.cbvSrvUavPool.Allocate();
+    rc.device->CreateCBV(*frame.constantBuffer, frame.cbv);
+
+    frame.instanceSRV = rc.cbvSrvUavPool.Allocate();
+    CreateInstanceBuffer(rc, descriptorHeap, frame, g_instanceFormat);
+
+    frame.visibleIndexBuffer =
+      std::make_unique<dxh::UploadHeapArray<uint32_t>>(rc.device->Get(), g_instanceCount);
+    frame.visibleIndexSRV = rc.cbvSrvUavPool.Allocate();
+    rc.device->CreateSRV(*frame.visibleIndexBuffer, frame.visibleIndexSRV);
+  }
+  size_t sceneVersion = 1;  // Bumped whenever instances move
 
-  dynamicDescriptorHeap.ParseRootSignature(rs);
-  dynamicDescriptorHeap.SetDescriptors(0, 0, 1, &cbv);
-  dynamicDescriptorHeap.SetDescriptors(0, 1, 1, &instanceSRV);
-
-  dxh::VertexShader vs{L"shaders.hlsl", "MainVS", D3DCOMPILE_DEBUG};
   dxh::PixelShader ps{L"shaders.hlsl", "MainPS", D3DCOMPILE_DEBUG};
 
   D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc{};
   psoDesc.InputLayout = {Vertex::inputLayout, Vertex::inputLayoutCount};
   psoDesc.pRootSignature = rs.GetRootSignature();
-  psoDesc.VS = D3D12_SHADER_BYTECODE(vs.ByteCode());
   psoDesc.PS = D3D12_SHADER_BYTECODE(ps.ByteCode());
   psoDesc.RTVFormats[0] = rc.swapChain->Format();
   psoDesc.NumRenderTargets = 1;
@@ -184,12 +302,21 @@ int WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow)
   psoDesc.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
   psoDesc.DSVFormat = rc.swapChainManager->DepthBufferFormat();
 
-
-  Microsoft::WRL::ComPtr<ID3D12PipelineState> pso;
-  rc.device->Get()->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(pso.GetAddressOf()));
+  // One PSO per instance format, each vertex shader decodes the format it is compiled for
+  Microsoft::WRL::ComPtr<ID3D12PipelineState> psos[static_cast<size_t>(InstanceFormat::Count)];
+  for (size_t format = 0; format < std::size(psos); ++format) {
+    std::string formatValue = std::to_string(format);
+    D3D_SHADER_MACRO defines[] = {{"INSTANCE_FORMAT", formatValue.c_str()}, {nullptr, nullptr}};
+    dxh::VertexShader vs{L"shaders.hlsl", "MainVS", D3DCOMPILE_DEBUG, defines};
+    psoDesc.VS = D3D12_SHADER_BYTECODE(vs.ByteCode());
+    rc.device->Get()->CreateGraphicsPipelineState(
+      &psoDesc, IID_PPV_ARGS(psos[format].GetAddressOf())
+    );
+  }
 
   dxh::PerspectiveCamera cam;
   cam.aspectRatio = rc.swapChain->Width() / static_cast<float>(rc.swapChain->Height());
+  g_lodScreenHeight = static_cast<int>(rc.swapChain->Height());
 
   dxh::Timer timer;
   timer.Start("main");
@@ -229,13 +356,13 @@ int WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow)
     cb.lightColor = LightColor(1.0f, {1.0f, 1.0f, 1.0f});
     cb.lightDir = LightDirection(timeSec, 2.f);
     cb.ambient = g_ambientColor;
-    constantBuffer.LoadElement(0, cb);
 
     if (g_tickInstances) {
       timer.Start("instances");
       long long instanceTime = timer.TimeElapsed("instances");
       float instanceTimeSec = static_cast<float>(instanceTime) / 1000.0f;
       UpdateInstances(instanceTimeSec);
+      ++sceneVersion;
     } else {
       timer.Pause("instances");
     }
@@ -244,26 +371,52 @@ int WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow)
     if (g_enableFrustumCulling) {
       DXH_SCOPED_AUTO_TIMER_OUT_RESULT(cullTime, dxh::Microseconds)
 
-      FrustumCullingSpace space = FrustumCullingSpace::World;
-
-      CullingAcceleration acc;
-      if (g_enableOctreeCulling) {
-        acc = g_tickInstances ? CullingAcceleration::DynamicOctree
-                              : CullingAcceleration::StaticOctree;
-      } else {
-        acc = CullingAcceleration::None;
-      }
+      FrustumCullingSpace space = FrustumCullingSpace::WorldParallel;
 
-      CullInstances(cam, space, acc);
+      CullInstances(cam, space, CurrentAcceleration());
     }
 
     size_t instanceDrawCount = g_enableFrustumCulling ? g_culledInstanceIndices.size()
                                                       : g_instanceCount;
+    std::vector<LodRange> drawRanges = g_lodRanges;
+    if (!g_enableFrustumCulling) {
+      drawRanges.assign(1, {0, g_instanceCount});
+    }
 
-    for (size_t i = 0; i < instanceDrawCount; ++i) {
-      instanceBuffer.LoadElement(
-        i, g_instanceBuffer[g_enableFrustumCulling ? g_culledInstanceIndices[i] : i]
+    // Work above only touches CPU memory and overlaps the GPU, the frame slot's buffers are
+    // rewritten once the GPU is done with the frame that last used them
+    dxh::FrameContext& frameContext = rc.BeginFrame();
+    FrameResources& frame = frameResources[rc.CurrentFrameIndex()];
+    frame.constantBuffer->LoadElement(0, cb);
+    if (frame.instanceFormat != g_instanceFormat) {
+      CreateInstanceBuffer(rc, descriptorHeap, frame, g_instanceFormat);
+    }
+    size_t instanceStride = InstanceFormatStride(frame.instanceFormat);
+
+    size_t instanceUploadBytes = 0;
+    bool useVisibleIndices = g_useVisibleIndexList && g_enableFrustumCulling;
+    if (g_useVisibleIndexList) {
+      if (frame.sceneVersion != sceneVersion) {
+        PackInstances(
+          frame.instanceFormat, g_instanceBuffer.data(), nullptr, g_instanceCount,
+          frame.instanceBuffer->Data()
+        );
+        instanceUploadBytes += g_instanceCount * instanceStride;
+        frame.sceneVersion = sceneVersion;
+      }
+      if (useVisibleIndices) {
+        StoreCulledInstanceIndices(frame.visibleIndexBuffer->Data());
+        instanceUploadBytes += instanceDrawCount * sizeof(uint32_t);
+      }
+    } else {
+      const size_t* gatherIndices = g_enableFrustumCulling ? g_culledInstanceIndices.data()
+                                                           : nullptr;
+      PackInstances(
+        frame.instanceFormat, g_instanceBuffer.data(), gatherIndices, instanceDrawCount,
+        frame.instanceBuffer->Data()
       );
+      instanceUploadBytes += instanceDrawCount * instanceStride;
+      frame.sceneVersion = g_enableFrustumCulling ? 0 : sceneVersion;
     }
 
     auto elapsedSinceLastStampMs = static_cast<float>(time - lastTimeStamp);
@@ -280,6 +433,21 @@ int WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow)
       oss << " | ";
       oss << "Culltime: " << std::setprecision(3) << static_cast<float>(cullTime) / 1000.f << " ms";
       oss << " | Mode: [" << GetModeString() << "]";
+      oss << " | Upload: " << std::setprecision(2)
+          << static_cast<float>(instanceUploadBytes) / (1024.f * 1024.f) << " MB";
+      if (drawRanges.size() > 1) {
+        oss << " | LODs:";
+        for (const auto& range : drawRanges) {
+          oss << " " << range.count;
+        }
+      }
+      if (g_tightBoundsStats.aabbFalsePositives > 0) {
+        oss << " | Removed vs AABB: " << g_tightBoundsStats.aabbFalsePositives;
+      }
+      if (g_planeCoherencyStats.rejections > 0) {
+        oss << " | Plane cache hits: " << std::setprecision(1)
+            << g_planeCoherencyStats.HitRate() * 100.f << "%";
+      }
 
       SetWindowText(hwnd, oss.str().c_str());
       accumulatedFrames = 0;
@@ -287,13 +455,16 @@ int WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow)
     }
 
 
-    cmdAlloc.Reset();
-    cmdList.Reset(cmdAlloc);
+    cmdList.Reset(*frameContext.cmdAlloc);
 
     cmdList.SetRootSignature(rs);
-    cmdList.SetPipelineState(pso.Get());
+    cmdList.SetPipelineState(psos[static_cast<size_t>(frame.instanceFormat)].Get());
 
-    dynamicDescriptorHeap.BindModifiedDescriptors(rc.device->Get(), cmdList.Get());
+    D3D12_CPU_DESCRIPTOR_HANDLE frameDescriptors[] = {
+      frame.cbv, frame.instanceSRV, frame.visibleIndexSRV
+    };
+    descriptorHeap.SetDescriptors(0, 0, 3, frameDescriptors);
+    descriptorHeap.BindModifiedDescriptors(rc.device->Get(), cmdList.Get());
 
     cmdList.SetViewport(*rc.swapChain);
     cmdList.SetScissorRect(*rc.swapChain);
@@ -303,20 +474,32 @@ int WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow)
 
     rc.ClearBackBuffer(cmdList, {0.2f, 0.3f, 0.3f, 1.0f});
 
-    cmdList.SetTriangleMeshToDraw(boxMesh);
-
-    cmdList.Get()->DrawIndexedInstanced(boxMeshData.IndexCount(), instanceDrawCount, 0, 0, 0);
+    for (size_t lod = 0; lod < drawRanges.size(); ++lod) {
+      const LodRange& range = drawRanges[lod];
+      if (range.count == 0) {
+        continue;
+      }
+      size_t meshIndex = std::min(lod, lodMeshes.size() - 1);
+      cmdList.SetTriangleMeshToDraw(*lodMeshes[meshIndex]);
+      UINT drawConstants[2] = {static_cast<UINT>(range.offset), useVisibleIndices ? 1u : 0u};
+      cmdList.Get()->SetGraphicsRoot32BitConstants(1, 2, drawConstants, 0);
+      cmdList.Get()->DrawIndexedInstanced(
+        static_cast<UINT>(lodIndexCounts[meshIndex]), static_cast<UINT>(range.count), 0, 0, 0
+      );
+    }
 
     rc.PrepareSwapChainForPresent(cmdList);
     rc.CloseAndExecute(cmdList);
-    rc.FlushCommandQueue();
-    rc.Present();
+    descriptorHeap.FinishFrame(rc.EndFrame());
 
     float frameEnd = frameTimer.TimeElapsed("frame");
     frameTimer.Reset("frame");
     auto logger = spdlog::get("instance_logger");
     logger->info("Frame time: {} ms", (frameEnd - frameStart) / 1000.f);
   }
+
+  // Frames still in flight read the upload buffers released below
+  rc.WaitForAllFrames();
 }
 
 
@@ -333,9 +516,37 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
           g_octreeBuilt = false;
         }
       }
+      if (wParam == 'I') {
+        g_useVisibleIndexList = !g_useVisibleIndexList;
+      }
       if (wParam == 'M') {
         g_tickInstances = !g_tickInstances;
       }
+      if (wParam == 'Z') {
+        g_enableOcclusionCulling = !g_enableOcclusionCulling;
+      }
+      if (wParam == 'B') {
+        g_useTightBounds = !g_useTightBounds;
+      }
+      if (wParam == 'L') {
+        g_enableLodSelection = !g_enableLodSelection;
+      }
+      if (wParam == 'P') {
+        g_usePlaneCoherency = !g_usePlaneCoherency;
+      }
+      if (wParam == 'F') {
+        auto next = static_cast<uint8_t>(g_instanceFormat) + 1;
+        g_instanceFormat = static_cast<InstanceFormat>(
+          next % static_cast<uint8_t>(InstanceFormat::Count)
+        );
+      }
+      if (wParam == 'A') {
+        auto next = static_cast<uint8_t>(g_accelerationKind) + 1;
+        g_accelerationKind = static_cast<AccelerationKind>(
+          next % static_cast<uint8_t>(AccelerationKind::Count)
+        );
+        g_octreeBuilt = false;
+      }
       return 0;
     case WM_DESTROY:
       PostQuitMessage(0);
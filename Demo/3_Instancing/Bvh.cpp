@@ -0,0 +1,311 @@
+#include "Bvh.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <numeric>
+
+namespace
+{
+
+AABB EmptyAABB()
+{
+  return {{FLT_MAX, FLT_MAX, FLT_MAX}, {-FLT_MAX, -FLT_MAX, -FLT_MAX}};
+}
+
+float SurfaceArea(const AABB& box)
+{
+  float dx = box.max.x - box.min.x;
+  float dy = box.max.y - box.min.y;
+  float dz = box.max.z - box.min.z;
+  return 2.f * (dx * dy + dy * dz + dz * dx);
+}
+
+// Surface area weighted by primitive count, empty sides cost nothing
+float SideCost(uint32_t count, const AABB& box)
+{
+  return count > 0 ? static_cast<float>(count) * SurfaceArea(box) : 0.f;
+}
+
+// Inlined MergeAABB, innermost loop of both build and refit
+void Grow(AABB& box, const AABB& other)
+{
+  box.min.x = std::min(box.min.x, other.min.x);
+  box.min.y = std::min(box.min.y, other.min.y);
+  box.min.z = std::min(box.min.z, other.min.z);
+  box.max.x = std::max(box.max.x, other.max.x);
+  box.max.y = std::max(box.max.y, other.max.y);
+  box.max.z = std::max(box.max.z, other.max.z);
+}
+
+AABB LeafBounds(const AABBSoA& bounds, const uint32_t* prims, uint32_t count)
+{
+  AABB box = bounds.Get(prims[0]);
+  for (uint32_t i = 1; i < count; ++i) {
+    Grow(box, bounds.Get(prims[i]));
+  }
+  return box;
+}
+
+struct Bin {
+  AABB bounds = EmptyAABB();
+  uint32_t count = 0;
+};
+
+}  // namespace
+
+void Bvh::Build(const AABBSoA& bounds)
+{
+  nodes.clear();
+
+  auto count = static_cast<uint32_t>(bounds.Size());
+  primIndices.resize(count);
+  std::iota(primIndices.begin(), primIndices.end(), 0u);
+  if (count == 0) {
+    buildCost = 0.f;
+    return;
+  }
+
+  buildBounds.resize(count);
+  buildCentroids.resize(count);
+  for (uint32_t i = 0; i < count; ++i) {
+    buildBounds[i] = bounds.Get(i);
+    buildCentroids[i] = {
+      (bounds.minX[i] + bounds.maxX[i]) * 0.5f,
+      (bounds.minY[i] + bounds.maxY[i]) * 0.5f,
+      (bounds.minZ[i] + bounds.maxZ[i]) * 0.5f
+    };
+  }
+
+  nodes.reserve(2 * (count / kMaxLeafSize) + 1);
+  nodes.emplace_back();
+  nodes[0].leftFirst = 0;
+  nodes[0].count = count;
+  nodes[0].bbox = LeafBounds(bounds, primIndices.data(), count);
+
+  std::vector<uint32_t> stack{0};
+  while (!stack.empty()) {
+    uint32_t nodeIndex = stack.back();
+    stack.pop_back();
+    Subdivide(nodeIndex);
+    if (!nodes[nodeIndex].IsLeaf()) {
+      stack.push_back(nodes[nodeIndex].leftFirst);
+      stack.push_back(nodes[nodeIndex].leftFirst + 1);
+    }
+  }
+
+  buildCost = SahCost();
+}
+
+void Bvh::Subdivide(uint32_t nodeIndex)
+{
+  uint32_t first = nodes[nodeIndex].leftFirst;
+  uint32_t count = nodes[nodeIndex].count;
+  if (count <= 2) {
+    return;
+  }
+
+  const AABB* primBounds = buildBounds.data() + first;
+  const DirectX::XMFLOAT3* centroids = buildCentroids.data() + first;
+
+  float centroidMin[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+  float centroidMax[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+  for (uint32_t i = 0; i < count; ++i) {
+    const float* c = &centroids[i].x;
+    for (int axis = 0; axis < 3; ++axis) {
+      centroidMin[axis] = std::min(centroidMin[axis], c[axis]);
+      centroidMax[axis] = std::max(centroidMax[axis], c[axis]);
+    }
+  }
+
+  float bestCost = FLT_MAX;
+  int bestAxis = -1;
+  int bestSplit = 0;  // Bins [0, bestSplit] go left
+  AABB bestLeft;
+  AABB bestRight;
+
+  for (int axis = 0; axis < 3; ++axis) {
+    float extent = centroidMax[axis] - centroidMin[axis];
+    if (extent <= 0.f) {
+      continue;
+    }
+
+    float scale = kBinCount / extent;
+    Bin bins[kBinCount];
+    for (uint32_t i = 0; i < count; ++i) {
+      float c = (&centroids[i].x)[axis];
+      int b = std::min(kBinCount - 1, static_cast<int>((c - centroidMin[axis]) * scale));
+      ++bins[b].count;
+      Grow(bins[b].bounds, primBounds[i]);
+    }
+
+    // Sweep from both ends so every split plane is evaluated in O(kBinCount)
+    float leftCost[kBinCount - 1];
+    AABB leftBox[kBinCount - 1];
+    AABB box = EmptyAABB();
+    uint32_t sum = 0;
+    for (int i = 0; i < kBinCount - 1; ++i) {
+      sum += bins[i].count;
+      Grow(box, bins[i].bounds);
+      leftCost[i] = SideCost(sum, box);
+      leftBox[i] = box;
+    }
+    box = EmptyAABB();
+    sum = 0;
+    for (int i = kBinCount - 1; i > 0; --i) {
+      sum += bins[i].count;
+      Grow(box, bins[i].bounds);
+      float cost = leftCost[i - 1] + SideCost(sum, box);
+      if (cost < bestCost) {
+        bestCost = cost;
+        bestAxis = axis;
+        bestSplit = i - 1;
+        bestLeft = leftBox[i - 1];
+        bestRight = box;
+      }
+    }
+  }
+
+  float nodeArea = SurfaceArea(nodes[nodeIndex].bbox);
+  float leafCost = static_cast<float>(count) * nodeArea;
+  float splitCost = bestCost + kTraversalCost * nodeArea;
+  if (bestAxis < 0 || (splitCost >= leafCost && count <= kMaxLeafSize)) {
+    return;
+  }
+
+  // Partition primitives, their bounds and centroids together
+  float cmin = centroidMin[bestAxis];
+  float scale = kBinCount / (centroidMax[bestAxis] - cmin);
+  auto goesLeft = [&](uint32_t i) {
+    float c = (&buildCentroids[i].x)[bestAxis];
+    return std::min(kBinCount - 1, static_cast<int>((c - cmin) * scale)) <= bestSplit;
+  };
+  uint32_t lo = first;
+  uint32_t hi = first + count;
+  while (lo < hi) {
+    if (goesLeft(lo)) {
+      ++lo;
+    } else {
+      --hi;
+      std::swap(primIndices[lo], primIndices[hi]);
+      std::swap(buildBounds[lo], buildBounds[hi]);
+      std::swap(buildCentroids[lo], buildCentroids[hi]);
+    }
+  }
+
+  uint32_t leftCount = lo - first;
+  if (leftCount == 0 || leftCount == count) {
+    return;
+  }
+
+  auto leftIndex = static_cast<uint32_t>(nodes.size());
+  nodes.emplace_back();
+  nodes.emplace_back();
+  nodes[leftIndex].bbox = bestLeft;
+  nodes[leftIndex].leftFirst = first;
+  nodes[leftIndex].count = leftCount;
+  nodes[leftIndex + 1].bbox = bestRight;
+  nodes[leftIndex + 1].leftFirst = first + leftCount;
+  nodes[leftIndex + 1].count = count - leftCount;
+
+  nodes[nodeIndex].leftFirst = leftIndex;
+  nodes[nodeIndex].count = 0;
+}
+
+void Bvh::Refit(const AABBSoA& bounds)
+{
+  for (size_t i = nodes.size(); i-- > 0;) {
+    BvhNode& node = nodes[i];
+    if (node.IsLeaf()) {
+      node.bbox = LeafBounds(bounds, primIndices.data() + node.leftFirst, node.count);
+    } else {
+      node.bbox = nodes[node.leftFirst].bbox;
+      Grow(node.bbox, nodes[node.leftFirst + 1].bbox);
+    }
+  }
+}
+
+bool Bvh::Update(const AABBSoA& bounds)
+{
+  if (nodes.empty() || bounds.Size() != primIndices.size()) {
+    Build(bounds);
+    return true;
+  }
+
+  Refit(bounds);
+  if (SahCost() > buildCost * kRebuildCostRatio) {
+    Build(bounds);
+    return true;
+  }
+  return false;
+}
+
+float Bvh::SahCost() const
+{
+  if (nodes.empty()) {
+    return 0.f;
+  }
+
+  float cost = 0.f;
+  for (const BvhNode& node : nodes) {
+    float area = SurfaceArea(node.bbox);
+    cost += node.IsLeaf() ? area * static_cast<float>(node.count) : area;
+  }
+  float rootArea = SurfaceArea(nodes[0].bbox);
+  return rootArea > 0.f ? cost / rootArea : 0.f;
+}
+
+std::pair<uint32_t, uint32_t> Bvh::PrimitiveRange(uint32_t nodeIndex) const
+{
+  uint32_t left = nodeIndex;
+  while (!nodes[left].IsLeaf()) {
+    left = nodes[left].leftFirst;
+  }
+  uint32_t right = nodeIndex;
+  while (!nodes[right].IsLeaf()) {
+    right = nodes[right].leftFirst + 1;
+  }
+  return {nodes[left].leftFirst, nodes[right].leftFirst + nodes[right].count};
+}
+
+void Bvh::Cull(
+  const Frustum& frustum,
+  std::vector<size_t>& outAccepted,
+  std::vector<size_t>& outCandidates
+) const
+{
+  if (nodes.empty()) {
+    return;
+  }
+
+  struct StackEntry {
+    uint32_t node;
+    uint8_t planeMask;
+  };
+  std::vector<StackEntry> stack;
+  stack.reserve(64);
+  stack.push_back({0, kAllFrustumPlanes});
+  while (!stack.empty()) {
+    auto [nodeIndex, mask] = stack.back();
+    stack.pop_back();
+    const BvhNode& node = nodes[nodeIndex];
+
+    CullResult result = ClassifyAABB(node.bbox, frustum, mask);
+    if (result == CullResult::Outside) {
+      continue;
+    }
+    if (result == CullResult::Inside) {
+      auto [first, last] = PrimitiveRange(nodeIndex);
+      auto primBegin = primIndices.begin();
+      outAccepted.insert(outAccepted.end(), primBegin + first, primBegin + last);
+      continue;
+    }
+    if (node.IsLeaf()) {
+      for (uint32_t i = node.leftFirst; i < node.leftFirst + node.count; ++i) {
+        outCandidates.push_back(primIndices[i]);
+      }
+    } else {
+      stack.push_back({node.leftFirst + 1, mask});
+      stack.push_back({node.leftFirst, mask});
+    }
+  }
+}
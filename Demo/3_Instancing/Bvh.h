@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "Culling.h"
+#include "PacketCulling.h"
+
+// Children of an interior node are stored next to each other at leftFirst and leftFirst + 1,
+// always after their parent, so a reverse walk over the node array visits children first
+struct BvhNode {
+  AABB bbox;
+  uint32_t leftFirst = 0;  // Left child of interior nodes, first primitive of leaves
+  uint32_t count = 0;      // Primitive count, 0 for interior nodes
+
+  bool IsLeaf() const { return count > 0; }
+};
+
+class Bvh
+{
+public:
+  static constexpr int kBinCount = 16;
+  static constexpr uint32_t kMaxLeafSize = 8;
+
+  // Cost of visiting an interior node relative to testing one primitive
+  static constexpr float kTraversalCost = 1.f;
+
+  // Rebuild once refitting made the tree this much worse than when it was built
+  static constexpr float kRebuildCostRatio = 1.5f;
+
+  // Top-down build splitting each node at the best of kBinCount - 1 planes per axis according to
+  // the surface area heuristic. Primitive i of `bounds` is reported as index i
+  void Build(const AABBSoA& bounds);
+
+  // Recomputes node bounds bottom-up from the current primitive bounds, topology is unchanged
+  void Refit(const AABBSoA& bounds);
+
+  // Refits and rebuilds when the SAH cost degraded past kRebuildCostRatio. Returns true if the
+  // tree was rebuilt
+  bool Update(const AABBSoA& bounds);
+
+  // Expected cost of a random ray/volume query relative to testing the root
+  float SahCost() const;
+
+  float BuildSahCost() const { return buildCost; }
+
+  // Appends primitives of subtrees fully inside the frustum to `outAccepted`, they need no further
+  // test, and primitives of leaves only intersecting it to `outCandidates`
+  void Cull(
+    const Frustum& frustum,
+    std::vector<size_t>& outAccepted,
+    std::vector<size_t>& outCandidates
+  ) const;
+
+  bool Empty() const { return nodes.empty(); }
+
+  size_t PrimitiveCount() const { return primIndices.size(); }
+
+  const std::vector<BvhNode>& Nodes() const { return nodes; }
+
+private:
+  // Primitives of a subtree are one contiguous range of primIndices, bounded by its leftmost and
+  // rightmost leaves
+  std::pair<uint32_t, uint32_t> PrimitiveRange(uint32_t nodeIndex) const;
+
+  // Splits a leaf whose bbox is already set into two children, or leaves it as is when no split
+  // beats the leaf cost
+  void Subdivide(uint32_t nodeIndex);
+
+  std::vector<BvhNode> nodes;
+  std::vector<uint32_t> primIndices;
+  float buildCost = 0.f;
+
+  // Primitive bounds and centroids permuted along with primIndices so a node's primitives are
+  // read sequentially, only used while building
+  std::vector<AABB> buildBounds;
+  std::vector<DirectX::XMFLOAT3> buildCentroids;
+};
@@ -2,6 +2,8 @@
 
 using namespace DirectX;
 
+#include <algorithm>
+#include <cfloat>
 #include <cmath>
 
 void GetAABBPoints(const AABB& box, XMVECTOR points[8])
@@ -18,26 +20,108 @@ void GetAABBPoints(const AABB& box, XMVECTOR points[8])
 
 AABB TransformAABB(const DirectX::XMMATRIX& mat, const AABB& box)
 {
-  XMVECTOR xmP[8];
-  GetAABBPoints(box, xmP);
+  // Arvo: the center is transformed, each half extent adds the absolute value of its image
+  auto xmMin = XMLoadFloat3(&box.min);
+  auto xmMax = XMLoadFloat3(&box.max);
+  auto xmCenter = XMVector3Transform(XMVectorScale(XMVectorAdd(xmMin, xmMax), 0.5f), mat);
+  XMFLOAT3 halfSize;
+  XMStoreFloat3(&halfSize, XMVectorScale(XMVectorSubtract(xmMax, xmMin), 0.5f));
+
+  auto xmExtent = XMVectorAbs(XMVectorScale(mat.r[0], halfSize.x));
+  xmExtent = XMVectorAdd(xmExtent, XMVectorAbs(XMVectorScale(mat.r[1], halfSize.y)));
+  xmExtent = XMVectorAdd(xmExtent, XMVectorAbs(XMVectorScale(mat.r[2], halfSize.z)));
+
+  AABB res;
+  XMStoreFloat3(&res.min, XMVectorSubtract(xmCenter, xmExtent));
+  XMStoreFloat3(&res.max, XMVectorAdd(xmCenter, xmExtent));
+  return res;
+}
+
+AABB MergeAABB(const AABB& a, const AABB& b)
+{
+  AABB res;
+  res.min = {std::min(a.min.x, b.min.x), std::min(a.min.y, b.min.y), std::min(a.min.z, b.min.z)};
+  res.max = {std::max(a.max.x, b.max.x), std::max(a.max.y, b.max.y), std::max(a.max.z, b.max.z)};
+  return res;
+}
 
-  for (auto& point : xmP) {
-    point = XMVector3Transform(point, mat);
+Sphere TransformSphere(const XMMATRIX& mat, const AABB& box)
+{
+  auto xmMin = XMLoadFloat3(&box.min);
+  auto xmMax = XMLoadFloat3(&box.max);
+  auto xmCenter = XMVectorScale(XMVectorAdd(xmMin, xmMax), 0.5f);
+  float halfDiagonal = XMVectorGetX(XMVector3Length(XMVectorSubtract(xmMax, xmCenter)));
+
+  float maxScale = 0.f;
+  for (int i = 0; i < 3; ++i) {
+    maxScale = std::max(maxScale, XMVectorGetX(XMVector3Length(mat.r[i])));
   }
 
-  XMVECTOR xmMin = xmP[0];
-  XMVECTOR xmMax = xmP[0];
-  for (int i = 1; i < 8; ++i) {
-    xmMin = XMVectorMin(xmMin, xmP[i]);
-    xmMax = XMVectorMax(xmMax, xmP[i]);
+  Sphere sphere;
+  XMStoreFloat3(&sphere.center, XMVector3Transform(xmCenter, mat));
+  sphere.radius = halfDiagonal * maxScale;
+  return sphere;
+}
+
+OBB TransformOBB(const XMMATRIX& mat, const AABB& box)
+{
+  auto xmMin = XMLoadFloat3(&box.min);
+  auto xmMax = XMLoadFloat3(&box.max);
+  auto xmCenter = XMVectorScale(XMVectorAdd(xmMin, xmMax), 0.5f);
+  XMFLOAT3 halfSize;
+  XMStoreFloat3(&halfSize, XMVectorScale(XMVectorSubtract(xmMax, xmMin), 0.5f));
+  const float halfExtents[3] = {halfSize.x, halfSize.y, halfSize.z};
+
+  OBB obb;
+  XMStoreFloat3(&obb.center, XMVector3Transform(xmCenter, mat));
+  for (int i = 0; i < 3; ++i) {
+    XMStoreFloat3(&obb.halfAxes[i], XMVectorScale(mat.r[i], halfExtents[i]));
   }
+  return obb;
+}
 
-  XMFLOAT3 pmin;
-  XMStoreFloat3(&pmin, xmMin);
-  XMFLOAT3 pmax;
-  XMStoreFloat3(&pmax, xmMax);
+namespace
+{
 
-  return {pmin, pmax};
+// Point where three planes meet, the planes must not share a direction
+XMVECTOR IntersectPlanes(const Plane& p0, const Plane& p1, const Plane& p2)
+{
+  XMVECTOR xmN0 = XMVectorSet(p0.a, p0.b, p0.c, 0.f);
+  XMVECTOR xmN1 = XMVectorSet(p1.a, p1.b, p1.c, 0.f);
+  XMVECTOR xmN2 = XMVectorSet(p2.a, p2.b, p2.c, 0.f);
+
+  XMVECTOR xmN1xN2 = XMVector3Cross(xmN1, xmN2);
+  XMVECTOR xmN2xN0 = XMVector3Cross(xmN2, xmN0);
+  XMVECTOR xmN0xN1 = XMVector3Cross(xmN0, xmN1);
+  float denom = XMVectorGetX(XMVector3Dot(xmN0, xmN1xN2));
+
+  XMVECTOR xmSum = XMVectorScale(xmN1xN2, -p0.d);
+  xmSum = XMVectorAdd(xmSum, XMVectorScale(xmN2xN0, -p1.d));
+  xmSum = XMVectorAdd(xmSum, XMVectorScale(xmN0xN1, -p2.d));
+  return XMVectorScale(xmSum, 1.f / denom);
+}
+
+}  // namespace
+
+AABB FrustumAABB(const Frustum& frustum)
+{
+  const Plane* planes = frustum.planes;
+  XMVECTOR xmMin = XMVectorReplicate(FLT_MAX);
+  XMVECTOR xmMax = XMVectorReplicate(-FLT_MAX);
+  for (int x = 0; x < 2; ++x) {
+    for (int y = 2; y < 4; ++y) {
+      for (int z = 4; z < 6; ++z) {
+        XMVECTOR xmCorner = IntersectPlanes(planes[x], planes[y], planes[z]);
+        xmMin = XMVectorMin(xmMin, xmCorner);
+        xmMax = XMVectorMax(xmMax, xmCorner);
+      }
+    }
+  }
+
+  AABB box;
+  XMStoreFloat3(&box.min, xmMin);
+  XMStoreFloat3(&box.max, xmMax);
+  return box;
 }
 
 bool AABB::Contains(const AABB& box) const
@@ -72,6 +156,77 @@ bool IntersectAABBPlane(const AABB& box, const Plane& plane)
   return sign > 0;
 }
 
+bool IntersectOBBPlane(const OBB& box, const Plane& plane)
+{
+  // Projected radius of the box onto the plane normal
+  float radius = 0.f;
+  for (const auto& axis : box.halfAxes) {
+    radius += std::fabs(plane.a * axis.x + plane.b * axis.y + plane.c * axis.z);
+  }
+  return plane(box.center) + radius > 0;
+}
+
+Plane NormalizePlane(const Plane& plane)
+{
+  float invLength = 1.f / std::sqrt(plane.a * plane.a + plane.b * plane.b + plane.c * plane.c);
+  return {plane.a * invLength, plane.b * invLength, plane.c * invLength, plane.d * invLength};
+}
+
+bool IntersectTightBoundsPlane(
+  const Sphere& sphere,
+  const OBB& box,
+  const Plane& plane,
+  TightBoundsStats& stats
+)
+{
+  float distance = plane(sphere.center);
+  if (distance <= -sphere.radius) {
+    ++stats.sphereRejections;
+    return false;
+  }
+  if (distance > sphere.radius) {
+    return true;
+  }
+
+  ++stats.obbTests;
+  if (!IntersectOBBPlane(box, plane)) {
+    ++stats.obbRejections;
+    return false;
+  }
+  return true;
+}
+
+CullResult ClassifyAABB(const AABB& box, const Frustum& frustum, uint8_t& planeMask)
+{
+  for (int i = 0; i < 6; ++i) {
+    uint8_t bit = 1u << i;
+    if (!(planeMask & bit)) {
+      continue;
+    }
+
+    const Plane& plane = frustum.planes[i];
+    const auto& pmin = box.min;
+    const auto& pmax = box.max;
+
+    // Corner furthest along the plane normal decides outside, the opposite one decides inside
+    XMFLOAT3 g;
+    g.x = (plane.a > 0) ? pmax.x : pmin.x;
+    g.y = (plane.b > 0) ? pmax.y : pmin.y;
+    g.z = (plane.c > 0) ? pmax.z : pmin.z;
+    if (!(plane(g) > 0)) {
+      return CullResult::Outside;
+    }
+
+    XMFLOAT3 h;
+    h.x = (plane.a > 0) ? pmin.x : pmax.x;
+    h.y = (plane.b > 0) ? pmin.y : pmax.y;
+    h.z = (plane.c > 0) ? pmin.z : pmax.z;
+    if (plane(h) > 0) {
+      planeMask &= ~bit;
+    }
+  }
+  return planeMask == 0 ? CullResult::Inside : CullResult::Intersect;
+}
 
 bool AABB::Intersect(const Plane& plane) const
 {
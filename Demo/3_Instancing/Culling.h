@@ -2,6 +2,9 @@
 
 #include <DirectXMath.h>
 
+#include <cstddef>
+#include <cstdint>
+
 struct Plane {
   float a;
   float b;
@@ -31,11 +34,130 @@ struct AABB {
   bool Intersect(const Frustum& frustum) const;
 };
 
+struct Sphere {
+  DirectX::XMFLOAT3 center = {0.f, 0.f, 0.f};
+  float radius = 0.f;
+};
+
+// Oriented box, each half axis goes from the center to the middle of a face
+struct OBB {
+  DirectX::XMFLOAT3 center = {0.f, 0.f, 0.f};
+  DirectX::XMFLOAT3 halfAxes[3] = {};
+};
+
 
 void GetAABBPoints(const AABB& box, DirectX::XMVECTOR points[8]);
 
 AABB TransformAABB(const DirectX::XMMATRIX& mat, const AABB& box);
 
+AABB MergeAABB(const AABB& a, const AABB& b);
+
+// Sphere around the transformed box, scaled by the largest axis scale of `mat`
+Sphere TransformSphere(const DirectX::XMMATRIX& mat, const AABB& box);
+
+// Exact image of the box under an affine `mat`
+OBB TransformOBB(const DirectX::XMMATRIX& mat, const AABB& box);
+
+// Bounds of the eight frustum corners, planes ordered left, right, bottom, top, near, far
+AABB FrustumAABB(const Frustum& frustum);
+
 bool IntersectAABBPlane(const AABB& box, const Plane& plane);
 
+bool IntersectOBBPlane(const OBB& box, const Plane& plane);
+
+// Same plane with a unit normal, so plane(point) is a signed distance
+Plane NormalizePlane(const Plane& plane);
+
+// Counters of the sphere then OBB tests, see IntersectTightBoundsPlane
+struct TightBoundsStats {
+  size_t sphereRejections = 0;
+  size_t obbTests = 0;  // Planes straddled by the sphere
+  size_t obbRejections = 0;
+  size_t aabbFalsePositives = 0;  // Objects rejected whose world AABB passes the frustum
+
+  void Add(const TightBoundsStats& other)
+  {
+    sphereRejections += other.sphereRejections;
+    obbTests += other.obbTests;
+    obbRejections += other.obbRejections;
+    aabbFalsePositives += other.aabbFalsePositives;
+  }
+};
+
+// Sphere decides the plane when it lies fully on one side, the OBB it bounds decides otherwise.
+// The plane must have a unit normal. Agrees with IntersectOBBPlane
+bool IntersectTightBoundsPlane(
+  const Sphere& sphere,
+  const OBB& box,
+  const Plane& plane,
+  TightBoundsStats& stats
+);
+
+enum class CullResult : uint8_t { Outside, Intersect, Inside };
+
+// One bit per frustum plane, a cleared bit marks a plane that fully contains an ancestor
+constexpr uint8_t kAllFrustumPlanes = 0x3F;
+
+// Tests `box` against the planes set in `planeMask` and clears the bits of planes it lies fully
+// inside of. Children of the box can start from the updated mask, provided everything below it is
+// contained in it. Outside agrees with AABB::Intersect(frustum) returning false
+CullResult ClassifyAABB(const AABB& box, const Frustum& frustum, uint8_t& planeMask);
+
+// Counters of per-object frustum tests, see TestPlanesCoherent
+struct PlaneCoherencyStats {
+  size_t planeTests = 0;
+  size_t rejections = 0;
+  size_t cachedRejections = 0;  // Rejected by the plane that rejected the object last time
+
+  void Add(const PlaneCoherencyStats& other)
+  {
+    planeTests += other.planeTests;
+    rejections += other.rejections;
+    cachedRejections += other.cachedRejections;
+  }
+
+  float HitRate() const
+  {
+    return rejections > 0 ? static_cast<float>(cachedRejections) / rejections : 0.f;
+  }
+};
+
+constexpr uint8_t kNoRejectingPlane = 0xFF;
+
+// Runs passesPlane(i) over the six frustum planes, starting with `rejectingPlane` which holds the
+// plane that rejected the object last time. Stores the plane rejecting it now, kNoRejectingPlane if
+// it passes all of them. Objects rejected by the same plane frame to frame take a single test
+template<typename PlaneTestFunc>
+bool TestPlanesCoherent(
+  uint8_t& rejectingPlane,
+  PlaneTestFunc passesPlane,
+  PlaneCoherencyStats& stats
+)
+{
+  uint8_t cached = rejectingPlane;
+  if (cached != kNoRejectingPlane) {
+    ++stats.planeTests;
+    if (!passesPlane(cached)) {
+      ++stats.rejections;
+      ++stats.cachedRejections;
+      return false;
+    }
+  }
+
+  for (uint8_t i = 0; i < 6; ++i) {
+    if (i == cached) {
+      continue;
+    }
+    ++stats.planeTests;
+    if (!passesPlane(i)) {
+      ++stats.rejections;
+      rejectingPlane = i;
+      return false;
+    }
+  }
+
+  rejectingPlane = kNoRejectingPlane;
+  return true;
+}
+
 Plane TransformPlane(const DirectX::XMMATRIX& mat, const Plane& plane);
\ No newline at end of file
@@ -0,0 +1,180 @@
+#include <string>
+#include <vector>
+
+#include "DescriptorHeap.h"
+#include "DescriptorTests.h"
+
+using dxh::DescriptorCopyBatch;
+
+namespace
+{
+
+constexpr UINT kIncrementSize = ID3D12Device::kIncrementSize;
+// Source descriptors live outside every heap the stub device creates
+constexpr SIZE_T kSourceBase = 0x8000;
+
+D3D12_CPU_DESCRIPTOR_HANDLE Source(SIZE_T index)
+{
+  return {kSourceBase + index * kIncrementSize};
+}
+
+std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> Sources(std::initializer_list<SIZE_T> indices)
+{
+  std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> handles;
+  for (SIZE_T index : indices) {
+    handles.push_back(Source(index));
+  }
+  return handles;
+}
+
+// Source ranges of `copy` as (first source index, size) pairs
+std::vector<std::pair<SIZE_T, UINT>> SourceRanges(const RecordedCopy& copy)
+{
+  std::vector<std::pair<SIZE_T, UINT>> ranges;
+  for (size_t i = 0; i < copy.srcStarts.size(); ++i) {
+    ranges.push_back({(copy.srcStarts[i].ptr - kSourceBase) / kIncrementSize, copy.srcSizes[i]});
+  }
+  return ranges;
+}
+
+void TestCoalescing()
+{
+  ID3D12Device device;
+  DescriptorCopyBatch batch{kIncrementSize};
+  D3D12_CPU_DESCRIPTOR_HANDLE dest{0x1000};
+
+  // Nothing added, nothing copied
+  batch.Copy(&device, dest, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+  Expect(device.copies.empty(), "batch: empty batch copied");
+
+  std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> adjacent = Sources({4, 5, 6});
+  batch.Add(adjacent.data(), adjacent.size());
+  Expect(batch.SourceRangeCount() == 1, "batch: three adjacent handles not one range");
+  Expect(batch.DescriptorCount() == 3, "batch: adjacent handles miscounted");
+  batch.Copy(&device, dest, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+  Expect(device.copies.size() == 1, "batch: adjacent handles not copied with one call");
+  if (device.copies.size() == 1) {
+    const RecordedCopy& copy = device.copies[0];
+    Expect(copy.dest.ptr == dest.ptr && copy.destSize == 3, "batch: wrong destination range");
+    Expect(
+      SourceRanges(copy) == std::vector<std::pair<SIZE_T, UINT>>{{4, 3}},
+      "batch: adjacent handles not copied as the range 4 to 6"
+    );
+    Expect(copy.type == D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, "batch: wrong heap type");
+  }
+
+  // Gaps, repeats and steps back each start a new range
+  device.copies.clear();
+  batch.Clear();
+  Expect(batch.DescriptorCount() == 0 && batch.SourceRangeCount() == 0, "batch: Clear kept ranges");
+  std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> scattered = Sources({0, 2, 3, 3, 1, 9});
+  batch.Add(scattered.data(), scattered.size());
+  Expect(batch.DescriptorCount() == 6, "batch: scattered handles miscounted");
+  batch.Copy(&device, dest, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+  Expect(device.copies.size() == 1, "batch: scattered handles not copied with one call");
+  if (device.copies.size() == 1) {
+    Expect(device.copies[0].destSize == 6, "batch: scattered destination miscounted");
+    Expect(
+      SourceRanges(device.copies[0]) ==
+        std::vector<std::pair<SIZE_T, UINT>>{{0, 1}, {2, 2}, {3, 1}, {1, 1}, {9, 1}},
+      "batch: non-contiguous handles not split into separate ranges"
+    );
+  }
+
+  // A run continues across Add calls
+  batch.Clear();
+  std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> first = Sources({7, 8});
+  std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> second = Sources({9, 10, 20});
+  batch.Add(first.data(), first.size());
+  batch.Add(second.data(), second.size());
+  Expect(batch.SourceRangeCount() == 2, "batch: run not continued across Add calls");
+}
+
+// BindModifiedDescriptors copies every dirty table of a bind with one CopyDescriptors call, the
+// tables back to back in root index order
+void TestOneCopyPerBind()
+{
+  ID3D12Device device;
+  dxh::QueueFence fence;
+  dxh::DynamicDescriptorHeap heap{&device, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, fence, 64};
+  ID3D12GraphicsCommandList commandList;
+
+  D3D12_DESCRIPTOR_RANGE three{3};
+  D3D12_DESCRIPTOR_RANGE two{2};
+  D3D12_DESCRIPTOR_RANGE four{4};
+  dxh::RootSignature rootSignature{{
+    {D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE, {1, &three}},
+    {D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS, {}},
+    {D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE, {1, &two}},
+    {D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE, {1, &four}},
+  }};
+  heap.ParseRootSignature(rootSignature);
+
+  std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> table0 = Sources({0, 1, 2});
+  std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> table2 = Sources({10, 12});
+  std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> table3 = Sources({20, 21, 22, 23});
+  heap.SetDescriptors(0, 0, 3, table0.data());
+  heap.SetDescriptors(2, 0, 2, table2.data());
+  heap.SetDescriptors(3, 0, 4, table3.data());
+  heap.BindModifiedDescriptors(&device, &commandList);
+
+  Expect(device.copies.size() == 1, "bind: dirty tables not copied with exactly one call");
+  Expect(commandList.binds.size() == 3, "bind: not every table bound");
+  if (device.copies.size() == 1 && commandList.binds.size() == 3) {
+    const RecordedCopy& copy = device.copies[0];
+    Expect(copy.destSize == 9, "bind: copy doesn't cover all three tables");
+    Expect(
+      SourceRanges(copy) ==
+        std::vector<std::pair<SIZE_T, UINT>>{{0, 3}, {10, 1}, {12, 1}, {20, 4}},
+      "bind: tables not copied in root index order with their runs coalesced"
+    );
+    UINT64 base = commandList.binds[0].table.ptr;
+    Expect(
+      commandList.binds[0].rootIndex == 0 && commandList.binds[1].rootIndex == 2 &&
+        commandList.binds[2].rootIndex == 3,
+      "bind: tables bound at the wrong root indices"
+    );
+    Expect(
+      commandList.binds[1].table.ptr == base + 3 * kIncrementSize &&
+        commandList.binds[2].table.ptr == base + 5 * kIncrementSize,
+      "bind: tables not back to back in the copied range"
+    );
+    Expect(
+      copy.dest.ptr + ID3D12Device::kGPUAddressOffset == base,
+      "bind: tables bound away from where they were copied"
+    );
+  }
+
+  // Only the modified table is copied again, still with one call
+  device.copies.clear();
+  commandList.binds.clear();
+  heap.BindModifiedDescriptors(&device, &commandList);
+  Expect(device.copies.empty() && commandList.binds.empty(), "bind: clean tables copied again");
+  heap.SetDescriptors(2, 1, 1, table0.data());
+  heap.BindModifiedDescriptors(&device, &commandList);
+  Expect(
+    device.copies.size() == 1 && device.copies[0].destSize == 2,
+    "bind: modified table not copied alone"
+  );
+  Expect(
+    commandList.binds.size() == 1 && commandList.binds[0].rootIndex == 2,
+    "bind: modified table not bound alone"
+  );
+
+  // A new frame binds every table again, with one call
+  device.copies.clear();
+  heap.FinishFrame(fence.Signal());
+  heap.BindModifiedDescriptors(&device, &commandList);
+  Expect(
+    device.copies.size() == 1 && device.copies[0].destSize == 9,
+    "bind: tables of a new frame not copied with one call"
+  );
+}
+
+}  // namespace
+
+void TestDescriptorCopyBatch()
+{
+  TestCoalescing();
+  TestOneCopyPerBind();
+}
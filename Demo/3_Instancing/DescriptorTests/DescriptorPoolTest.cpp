@@ -0,0 +1,138 @@
+#include <algorithm>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "DescriptorHeap.h"
+#include "DescriptorTests.h"
+
+namespace
+{
+
+constexpr UINT kDescriptorsPerHeap = 16;
+constexpr UINT kIncrementSize = ID3D12Device::kIncrementSize;
+
+using TestPool = dxh::DescriptorPool<
+  D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV,
+  D3D12_DESCRIPTOR_HEAP_FLAG_NONE,
+  kDescriptorsPerHeap>;
+
+// Heap the stub device placed `handle` in, 0 for none
+SIZE_T HeapOf(D3D12_CPU_DESCRIPTOR_HANDLE handle)
+{
+  return handle.ptr / ID3D12Device::kHeapSpacing;
+}
+
+// Ranges stay inside one heap and heaps fill up before a new one is created
+void TestHeapGrowth()
+{
+  ID3D12Device device;
+  TestPool pool{&device};
+
+  std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> handles;
+  for (UINT i = 0; i < kDescriptorsPerHeap; ++i) {
+    handles.push_back(pool.Allocate());
+  }
+  Expect(device.heapCount == 1, "pool: more than one heap for its first 16 descriptors");
+
+  D3D12_CPU_DESCRIPTOR_HANDLE range = pool.Allocate(4);
+  Expect(device.heapCount == 2, "pool: no new heap once the first was full");
+  Expect(HeapOf(range) == 2, "pool: range not in the new heap");
+
+  // A freed descriptor of the old heap is reused once the newest heap is full
+  pool.Free(handles[5]);
+  D3D12_CPU_DESCRIPTOR_HANDLE rest = pool.Allocate(kDescriptorsPerHeap - 4);
+  Expect(HeapOf(rest) == 2, "pool: rest of the newest heap not used first");
+  D3D12_CPU_DESCRIPTOR_HANDLE reused = pool.Allocate();
+  Expect(reused.ptr == handles[5].ptr, "pool: freed descriptor of the old heap not reused");
+  Expect(device.heapCount == 2, "pool: new heap while a freed descriptor was left");
+
+  dxh::DescriptorRangeStats stats = pool.Stats();
+  Expect(stats.capacity == 2 * kDescriptorsPerHeap, "pool: capacity not summed over heaps");
+  Expect(stats.freeCount == 0, "pool: free descriptors left after filling both heaps");
+
+  pool.FreeAll();
+  Expect(pool.Stats().capacity == 0, "pool: heaps left after FreeAll");
+  pool.Allocate();
+  Expect(device.heapCount == 3, "pool: no new heap after FreeAll");
+
+  // A whole heap in one range, its size class rounds up past the heap
+  D3D12_CPU_DESCRIPTOR_HANDLE whole = pool.Allocate(kDescriptorsPerHeap);
+  Expect(HeapOf(whole) == 4, "pool: whole heap range not in a new heap");
+  Expect(whole.ptr == 4 * ID3D12Device::kHeapSpacing, "pool: whole heap range not at its start");
+  pool.Free(whole, kDescriptorsPerHeap);
+  Expect(pool.Stats().freeCount == 2 * kDescriptorsPerHeap - 1, "pool: whole heap not freed");
+}
+
+// Random ranges freed in random order land back in the heap they came from
+void TestRandomFrees()
+{
+  ID3D12Device device;
+  TestPool pool{&device};
+  std::mt19937 rng{21};
+
+  struct Range {
+    D3D12_CPU_DESCRIPTOR_HANDLE handle;
+    UINT count;
+  };
+  std::vector<Range> live;
+  std::map<SIZE_T, UINT> liveByAddress;
+  UINT liveCount = 0;
+
+  size_t failureCount = 0;
+  for (int step = 0; step < 5'000 && failureCount == 0; ++step) {
+    if (live.empty() || rng() % 100 < 55) {
+      UINT count = 1 + rng() % (rng() % 4 == 0 ? kDescriptorsPerHeap : 4);
+      D3D12_CPU_DESCRIPTOR_HANDLE handle = pool.Allocate(count);
+
+      // Within one heap and clear of every live range
+      SIZE_T heapStart = HeapOf(handle) * ID3D12Device::kHeapSpacing;
+      SIZE_T end = handle.ptr + SIZE_T{count} * kIncrementSize;
+      bool inHeap = HeapOf(handle) > 0 && end <= heapStart + kDescriptorsPerHeap * kIncrementSize;
+      auto next = liveByAddress.lower_bound(handle.ptr);
+      bool overlaps = next != liveByAddress.end() && next->first < end;
+      if (next != liveByAddress.begin()) {
+        auto prev = std::prev(next);
+        overlaps = overlaps || prev->first + SIZE_T{prev->second} * kIncrementSize > handle.ptr;
+      }
+      Expect(inHeap && !overlaps, "pool: range at " + std::to_string(handle.ptr) + " overlaps");
+      failureCount += !inHeap || overlaps;
+
+      live.push_back({handle, count});
+      liveByAddress[handle.ptr] = count;
+      liveCount += count;
+    } else {
+      size_t index = rng() % live.size();
+      Range range = live[index];
+      live[index] = live.back();
+      live.pop_back();
+      pool.Free(range.handle, range.count);
+      liveByAddress.erase(range.handle.ptr);
+      liveCount -= range.count;
+    }
+
+    dxh::DescriptorRangeStats stats = pool.Stats();
+    bool countsMatch = stats.capacity == device.heapCount * kDescriptorsPerHeap &&
+                       stats.freeCount == stats.capacity - liveCount;
+    Expect(countsMatch, "pool: free count off at step " + std::to_string(step));
+    failureCount += !countsMatch;
+  }
+
+  for (const Range& range : live) {
+    pool.Free(range.handle, range.count);
+  }
+  dxh::DescriptorRangeStats stats = pool.Stats();
+  Expect(stats.freeCount == stats.capacity, "pool: descriptors left after freeing everything");
+  Expect(
+    stats.freeRangeCount == device.heapCount, "pool: heaps not one free range each after freeing"
+  );
+}
+
+}  // namespace
+
+void TestDescriptorPool()
+{
+  TestHeapGrowth();
+  TestRandomFrees();
+}
@@ -0,0 +1,226 @@
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "DescriptorRangeAllocator.h"
+#include "DescriptorTests.h"
+
+using dxh::DescriptorRangeAllocator;
+using dxh::DescriptorRangeStats;
+
+namespace
+{
+
+constexpr uint32_t kInvalidOffset = DescriptorRangeAllocator::kInvalidOffset;
+
+// Free ranges found by walking a slot map, what Stats() must report
+struct ReferenceStats {
+  uint32_t freeCount = 0;
+  uint32_t freeRangeCount = 0;
+  uint32_t largestFreeRange = 0;
+};
+
+ReferenceStats ReferenceStatsOf(const std::vector<bool>& used)
+{
+  ReferenceStats stats;
+  uint32_t run = 0;
+  for (size_t slot = 0; slot <= used.size(); ++slot) {
+    if (slot < used.size() && !used[slot]) {
+      ++run;
+      continue;
+    }
+    if (run > 0) {
+      stats.freeCount += run;
+      ++stats.freeRangeCount;
+      stats.largestFreeRange = std::max(stats.largestFreeRange, run);
+    }
+    run = 0;
+  }
+  return stats;
+}
+
+// False when any check failed
+bool ExpectStats(
+  const DescriptorRangeAllocator& allocator,
+  const std::vector<bool>& used,
+  const std::string& name
+)
+{
+  ReferenceStats expected = ReferenceStatsOf(used);
+  DescriptorRangeStats stats = allocator.Stats();
+  float fragmentation =
+    expected.freeCount == 0 ? 0.f : 1.f - float(expected.largestFreeRange) / expected.freeCount;
+  bool ok = true;
+  auto check = [&](bool condition, const std::string& what) {
+    Expect(condition, name + ": " + what);
+    ok = ok && condition;
+  };
+  check(stats.capacity == used.size(), "capacity " + std::to_string(stats.capacity));
+  check(
+    stats.freeCount == expected.freeCount && allocator.FreeCount() == expected.freeCount,
+    "free count " + std::to_string(stats.freeCount) + ", expected " +
+      std::to_string(expected.freeCount)
+  );
+  check(
+    stats.freeRangeCount == expected.freeRangeCount,
+    "free ranges " + std::to_string(stats.freeRangeCount) + ", expected " +
+      std::to_string(expected.freeRangeCount)
+  );
+  check(
+    stats.largestFreeRange == expected.largestFreeRange,
+    "largest free range " + std::to_string(stats.largestFreeRange) + ", expected " +
+      std::to_string(expected.largestFreeRange)
+  );
+  check(
+    std::fabs(stats.Fragmentation() - fragmentation) < 1e-6f,
+    "fragmentation " + std::to_string(stats.Fragmentation()) + ", expected " +
+      std::to_string(fragmentation)
+  );
+  return ok;
+}
+
+void TestCapacityEdges()
+{
+  DescriptorRangeAllocator empty{0};
+  Expect(empty.Allocate(1) == kInvalidOffset, "capacity 0: allocated");
+  ExpectStats(empty, {}, "capacity 0");
+
+  DescriptorRangeAllocator single{1};
+  Expect(single.Allocate(0) == kInvalidOffset, "capacity 1: allocated 0 slots");
+  Expect(single.Allocate(2) == kInvalidOffset, "capacity 1: allocated past the capacity");
+  uint32_t offset = single.Allocate(1);
+  Expect(offset == 0, "capacity 1: slot 0 not allocated");
+  Expect(single.Allocate(1) == kInvalidOffset, "capacity 1: allocated twice");
+  ExpectStats(single, {true}, "capacity 1 full");
+  single.Free(offset, 1);
+  ExpectStats(single, {false}, "capacity 1 freed");
+
+  // The whole capacity in one range, at class boundaries and past them
+  for (uint32_t capacity : {7u, 8u, 9u, 1024u, 1025u, 100'000u}) {
+    std::string name = "capacity " + std::to_string(capacity);
+    DescriptorRangeAllocator allocator{capacity};
+    Expect(allocator.Allocate(capacity + 1) == kInvalidOffset, name + ": allocated past it");
+    Expect(allocator.Allocate(UINT32_MAX) == kInvalidOffset, name + ": allocated UINT32_MAX");
+    uint32_t whole = allocator.Allocate(capacity);
+    Expect(whole == 0, name + ": whole capacity not allocated at 0");
+    Expect(allocator.Allocate(1) == kInvalidOffset, name + ": allocated when full");
+    ExpectStats(allocator, std::vector<bool>(capacity, true), name + " full");
+    allocator.Free(whole, capacity);
+    ExpectStats(allocator, std::vector<bool>(capacity, false), name + " freed");
+
+    allocator.Allocate(1);
+    allocator.Allocate(capacity / 2);
+    allocator.Reset(capacity);
+    ExpectStats(allocator, std::vector<bool>(capacity, false), name + " reset");
+  }
+}
+
+// Frees a range between each combination of free and used neighbors
+void TestNeighborMerging()
+{
+  constexpr uint32_t kRangeSize = 4;
+  constexpr uint32_t kRangeCount = 6;
+  DescriptorRangeAllocator allocator{kRangeSize * kRangeCount};
+  std::vector<bool> used(kRangeSize * kRangeCount, false);
+  std::vector<uint32_t> offsets;
+  for (uint32_t i = 0; i < kRangeCount; ++i) {
+    offsets.push_back(allocator.Allocate(kRangeSize));
+    Expect(offsets.back() != kInvalidOffset, "merging: range " + std::to_string(i) + " failed");
+  }
+  std::sort(offsets.begin(), offsets.end());
+  for (uint32_t i = 0; i < kRangeCount; ++i) {
+    Expect(offsets[i] == i * kRangeSize, "merging: ranges not back to back");
+  }
+  std::fill(used.begin(), used.end(), true);
+
+  auto freeRange = [&](uint32_t index, const std::string& name) {
+    allocator.Free(offsets[index], kRangeSize);
+    std::fill_n(used.begin() + offsets[index], kRangeSize, false);
+    ExpectStats(allocator, used, "merging: " + name);
+  };
+  freeRange(1, "both neighbors used");
+  freeRange(3, "both neighbors used again");
+  freeRange(2, "both neighbors free");
+  freeRange(0, "free next neighbor");
+  freeRange(5, "last range, previous neighbor used");
+  freeRange(4, "both neighbors free, whole capacity");
+  Expect(allocator.Stats().freeRangeCount == 1, "merging: capacity not one range again");
+}
+
+// Random allocations and frees checked against a map of used slots
+void TestAgainstSlotMap(uint32_t capacity, uint32_t seed)
+{
+  std::string name = "random, capacity " + std::to_string(capacity);
+  std::mt19937 rng{seed};
+  DescriptorRangeAllocator allocator{capacity};
+  std::vector<bool> used(capacity, false);
+  struct Range {
+    uint32_t offset;
+    uint32_t count;
+  };
+  std::vector<Range> live;
+
+  uint32_t maxCount = std::max(1u, std::min(capacity, 300u));
+  size_t failureCount = 0;
+  for (int step = 0; step < 20'000 && failureCount == 0; ++step) {
+    bool allocate = live.empty() || rng() % 100 < 55;
+    if (allocate) {
+      // Mostly small ranges, a quarter up to 300
+      uint32_t count = 1 + rng() % (rng() % 4 == 0 ? maxCount : std::min(maxCount, 8u));
+      uint32_t offset = allocator.Allocate(count);
+      if (offset == kInvalidOffset) {
+        uint32_t largest = ReferenceStatsOf(used).largestFreeRange;
+        bool fits = largest >= count;
+        Expect(
+          !fits, name + ": " + std::to_string(count) + " slots failed with a free range of " +
+                   std::to_string(largest)
+        );
+        failureCount += fits;
+        continue;
+      }
+      bool inside = offset < capacity && count <= capacity - offset;
+      bool overlaps = inside && std::any_of(
+                                  used.begin() + offset, used.begin() + offset + count,
+                                  [](bool slotUsed) { return slotUsed; }
+                                );
+      Expect(inside && !overlaps, name + ": range at " + std::to_string(offset) + " overlaps");
+      if (!inside || overlaps) {
+        ++failureCount;
+        continue;
+      }
+      std::fill_n(used.begin() + offset, count, true);
+      live.push_back({offset, count});
+    } else {
+      size_t index = rng() % live.size();
+      Range range = live[index];
+      live[index] = live.back();
+      live.pop_back();
+      allocator.Free(range.offset, range.count);
+      std::fill_n(used.begin() + range.offset, range.count, false);
+    }
+
+    if ((capacity <= 64 || step % 16 == 0) &&
+        !ExpectStats(allocator, used, name + ", step " + std::to_string(step))) {
+      ++failureCount;
+    }
+  }
+
+  for (const Range& range : live) {
+    allocator.Free(range.offset, range.count);
+  }
+  std::fill(used.begin(), used.end(), false);
+  ExpectStats(allocator, used, name + ", all freed");
+}
+
+}  // namespace
+
+void TestDescriptorRangeAllocator()
+{
+  TestCapacityEdges();
+  TestNeighborMerging();
+  for (uint32_t capacity : {1u, 7u, 8u, 64u, 1000u, 4096u}) {
+    TestAgainstSlotMap(capacity, capacity);
+  }
+}
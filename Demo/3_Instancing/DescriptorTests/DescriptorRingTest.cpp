@@ -0,0 +1,217 @@
+#include <string>
+#include <vector>
+
+#include "DescriptorRing.h"
+#include "DescriptorTests.h"
+#include "Fence.h"
+
+using dxh::DescriptorRing;
+using dxh::QueueFence;
+
+namespace
+{
+
+constexpr uint32_t kInvalidOffset = DescriptorRing::kInvalidOffset;
+constexpr uint32_t kCapacity = 16;
+
+// Ends the frame with a new fence value, returns it
+uint64_t FinishFrame(DescriptorRing& ring, QueueFence& fence)
+{
+  uint64_t fenceValue = fence.Signal();
+  ring.FinishFrame(fenceValue);
+  return fenceValue;
+}
+
+// A range that doesn't fit before the end of the heap starts the next lap at offset 0. The
+// skipped slots stay in use until the frame that skipped them is reclaimed
+void TestWrapAround()
+{
+  DescriptorRing ring{kCapacity};
+  QueueFence fence;
+
+  Expect(ring.Allocate(6) == 0, "wrap: first range not at 0");
+  uint64_t first = FinishFrame(ring, fence);
+  Expect(ring.Allocate(6) == 6, "wrap: second range not after the first");
+  FinishFrame(ring, fence);
+  fence.Complete(first);
+  ring.Reclaim(fence.CompletedValue());
+
+  // 4 slots left at the end, the range goes to the start where the first frame was
+  Expect(ring.Allocate(6) == 0, "wrap: range past the end not moved to the start");
+  Expect(ring.Lap() == 1, "wrap: lap " + std::to_string(ring.Lap()) + " after going around");
+  Expect(ring.UsedCount() == kCapacity, "wrap: skipped slots not counted as used");
+  Expect(ring.Allocate(1) == kInvalidOffset, "wrap: allocated over the second frame");
+  uint64_t third = FinishFrame(ring, fence);
+
+  // The second frame's slots come back, the skipped ones stay with the third frame
+  fence.Complete(third - 1);
+  ring.Reclaim(fence.CompletedValue());
+  Expect(ring.UsedCount() == 10, "wrap: skipped slots reclaimed before their frame");
+  Expect(ring.Allocate(6) == 6, "wrap: second frame's slots not reused");
+  Expect(ring.Allocate(4) == kInvalidOffset, "wrap: skipped slots reused before their frame");
+  FinishFrame(ring, fence);
+  fence.Complete(third);
+  ring.Reclaim(fence.CompletedValue());
+  Expect(ring.Allocate(4) == 12, "wrap: skipped slots not reused after their frame");
+
+  // Ranges never cross the end of the heap
+  DescriptorRing odd{kCapacity};
+  uint32_t position = 0;
+  for (uint32_t count : {5u, 5u, 5u, 3u, 7u, 9u, 16u, 1u}) {
+    uint32_t offset = odd.Allocate(count);
+    bool wraps = position % kCapacity + count > kCapacity;
+    uint32_t expected = wraps ? 0 : position % kCapacity;
+    Expect(
+      offset == expected, "wrap: " + std::to_string(count) + " slots at " +
+                            std::to_string(offset) + ", expected " + std::to_string(expected)
+    );
+    position = expected + count;
+    odd.Reclaim(FinishFrame(odd, fence));
+  }
+}
+
+// Slots of a frame come back only once the fence reaches the frame's value, frames in order
+void TestReclaim()
+{
+  DescriptorRing ring{kCapacity};
+  QueueFence fence;
+
+  ring.Allocate(4);
+  uint64_t first = FinishFrame(ring, fence);
+  ring.Allocate(4);
+  uint64_t second = FinishFrame(ring, fence);
+  ring.Allocate(8);
+  uint64_t third = FinishFrame(ring, fence);
+  Expect(ring.PendingFrameCount() == 3, "reclaim: frames not pending");
+
+  ring.Reclaim(first - 1);
+  Expect(ring.UsedCount() == kCapacity, "reclaim: slots returned before the fence reached them");
+  Expect(ring.Allocate(1) == kInvalidOffset, "reclaim: allocated over pending frames");
+
+  ring.Reclaim(second);
+  Expect(ring.PendingFrameCount() == 1, "reclaim: completed frames still pending");
+  Expect(ring.UsedCount() == 8, "reclaim: completed frames' slots not returned");
+  Expect(ring.Allocate(8) == 0, "reclaim: returned slots not reused");
+  Expect(ring.Allocate(1) == kInvalidOffset, "reclaim: allocated over the third frame");
+
+  // An empty frame adds nothing to wait for
+  FinishFrame(ring, fence);
+  uint64_t empty = FinishFrame(ring, fence);
+  Expect(ring.PendingFrameCount() == 2, "reclaim: empty frame pending");
+  ring.Reclaim(third);
+  Expect(ring.UsedCount() == 8, "reclaim: third frame's slots not returned");
+  ring.Reclaim(empty);
+  Expect(ring.UsedCount() == 0 && ring.PendingFrameCount() == 0, "reclaim: ring not empty");
+}
+
+// Allocate with a fence reclaims completed frames, then waits on the oldest pending frame at a
+// time until the range fits
+void TestAllocateWaits()
+{
+  DescriptorRing ring{kCapacity};
+  QueueFence fence;
+
+  std::vector<uint64_t> frames;
+  for (int frame = 0; frame < 3; ++frame) {
+    ring.Allocate(5, fence);
+    frames.push_back(FinishFrame(ring, fence));
+  }
+  Expect(fence.WaitedValues().empty(), "waits: waited while the ring had room");
+
+  // 1 slot left at the end, the range needs the first frame's slots
+  Expect(ring.Allocate(4, fence) == 0, "waits: range not placed after the first frame");
+  Expect(
+    fence.WaitedValues() == std::vector<uint64_t>{frames[0]},
+    "waits: didn't wait for exactly the oldest frame"
+  );
+  Expect(ring.PendingFrameCount() == 2, "waits: waited frame still pending");
+
+  // Needs both remaining frames, waited for one after the other
+  Expect(ring.Allocate(8, fence) == 4, "waits: range not placed after the waits");
+  Expect(
+    fence.WaitedValues() == std::vector<uint64_t>{frames[0], frames[1], frames[2]},
+    "waits: didn't wait for the frames in order"
+  );
+
+  // Frames the fence already passed are reclaimed without waiting
+  uint64_t next = FinishFrame(ring, fence);
+  fence.Complete(next);
+  Expect(ring.Allocate(kCapacity, fence) == 0, "waits: completed frame not reclaimed");
+  Expect(fence.WaitedValues().size() == 3, "waits: waited for a completed frame");
+}
+
+// Lap counts the times allocation went back to the start of the heap, including ranges that end
+// exactly at the end
+void TestLap()
+{
+  DescriptorRing ring{kCapacity};
+  QueueFence fence;
+
+  uint64_t expectedLap = 0;
+  uint32_t previousOffset = 0;
+  for (uint32_t frame = 0; frame < 40; ++frame) {
+    uint32_t count = 1 + (frame * 7) % 8;
+    uint32_t offset = ring.Allocate(count, fence);
+    if (frame > 0 && offset <= previousOffset) {
+      ++expectedLap;
+    }
+    Expect(
+      ring.Lap() == expectedLap, "lap: " + std::to_string(ring.Lap()) + " at frame " +
+                                   std::to_string(frame) + ", expected " +
+                                   std::to_string(expectedLap)
+    );
+    previousOffset = offset;
+    FinishFrame(ring, fence);
+  }
+  Expect(expectedLap > 3, "lap: too few laps to check");
+
+  DescriptorRing exact{kCapacity};
+  exact.Allocate(kCapacity);
+  Expect(exact.Lap() == 0, "lap: range ending at the end started a lap");
+  exact.Reclaim(FinishFrame(exact, fence));
+  Expect(exact.Allocate(1) == 0 && exact.Lap() == 1, "lap: no new lap after the exact end");
+}
+
+// With nothing left to wait for, only the current frame's own slots, retained ones included, keep
+// a range from fitting
+void TestCurrentFrameFull()
+{
+  DescriptorRing ring{kCapacity};
+  QueueFence fence;
+
+  Expect(ring.Allocate(0, fence) == kInvalidOffset, "full: allocated 0 slots");
+  Expect(ring.Allocate(kCapacity + 1, fence) == kInvalidOffset, "full: allocated past capacity");
+
+  ring.Allocate(4, fence);
+  uint64_t first = FinishFrame(ring, fence);
+  ring.Allocate(10, fence);
+  Expect(ring.Allocate(8, fence) == kInvalidOffset, "full: allocated over the current frame");
+  Expect(
+    fence.WaitedValues() == std::vector<uint64_t>{first},
+    "full: didn't wait for the pending frame before giving up"
+  );
+  Expect(ring.PendingFrameCount() == 0, "full: waited frame still pending");
+  Expect(ring.Allocate(2, fence) == 14, "full: room left before the end not used");
+
+  // Slots of the previous frame retained by the current one count as its own
+  DescriptorRing retaining{kCapacity};
+  uint32_t kept = retaining.Allocate(6);
+  FinishFrame(retaining, fence);
+  Expect(retaining.Retain(kept), "full: slots of the previous frame not retained");
+  retaining.Allocate(6, fence);
+  Expect(
+    retaining.Allocate(6, fence) == kInvalidOffset, "full: allocated over retained slots"
+  );
+  Expect(retaining.UsedCount() == 12, "full: retained slots reclaimed with their frame");
+}
+
+}  // namespace
+
+void TestDescriptorRing()
+{
+  TestWrapAround();
+  TestReclaim();
+  TestAllocateWaits();
+  TestLap();
+  TestCurrentFrameFull();
+}
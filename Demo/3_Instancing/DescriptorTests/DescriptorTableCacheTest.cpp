@@ -0,0 +1,140 @@
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "DescriptorHeap.h"
+#include "DescriptorTests.h"
+
+using dxh::DescriptorTableCache;
+
+namespace
+{
+
+constexpr uint64_t Bit(size_t rootIndex)
+{
+  return uint64_t{1} << rootIndex;
+}
+
+// Tables at both ends of the 64 bit masks and around the 32 bit boundary
+constexpr size_t kTableRootIndices[] = {0, 1, 31, 32, 33, 62, 63};
+
+DescriptorTableCache MakeCache()
+{
+  DescriptorTableCache cache;
+  UINT handleOffset = 0;
+  for (size_t rootIndex : kTableRootIndices) {
+    UINT descriptorCount = static_cast<UINT>(rootIndex % 5 + 1);
+    cache.tables[rootIndex] = {handleOffset, descriptorCount};
+    cache.tableMask |= Bit(rootIndex);
+    handleOffset += descriptorCount;
+  }
+  cache.handles.resize(handleOffset);
+  return cache;
+}
+
+// DescriptorCount only adds up the tables whose bits are set
+void TestDescriptorCount()
+{
+  DescriptorTableCache cache = MakeCache();
+  Expect(cache.DescriptorCount(0) == 0, "cache: descriptors counted for an empty mask");
+  Expect(
+    cache.DescriptorCount(cache.tableMask) == cache.handles.size(),
+    "cache: all tables don't add up to every handle"
+  );
+  for (size_t rootIndex : kTableRootIndices) {
+    Expect(
+      cache.DescriptorCount(Bit(rootIndex)) == rootIndex % 5 + 1,
+      "cache: table " + std::to_string(rootIndex) + " miscounted alone"
+    );
+  }
+  Expect(
+    cache.DescriptorCount(Bit(0) | Bit(63)) == 1 + 4, "cache: tables at bits 0 and 63 miscounted"
+  );
+  Expect(
+    cache.DescriptorCount(Bit(31) | Bit(32) | Bit(33)) == 2 + 3 + 4,
+    "cache: tables around bit 32 miscounted"
+  );
+}
+
+void TestDirtyMask()
+{
+  DescriptorTableCache cache = MakeCache();
+  Expect(!cache.IsDirty(), "cache: dirty before anything was set");
+  cache.MarkAllDirty();
+  Expect(cache.dirtyMask == cache.tableMask, "cache: MarkAllDirty missed tables");
+  Expect(cache.IsDirty(), "cache: not dirty after MarkAllDirty");
+  cache.ClearDirty();
+  Expect(!cache.IsDirty() && cache.dirtyMask == 0, "cache: dirty after ClearDirty");
+
+  cache.dirtyMask = Bit(63);
+  Expect(cache.IsDirty(), "cache: only bit 63 set isn't dirty");
+
+  cache.Clear();
+  Expect(
+    cache.tableMask == 0 && cache.dirtyMask == 0 && cache.handles.empty(),
+    "cache: Clear kept tables"
+  );
+  cache.MarkAllDirty();
+  Expect(!cache.IsDirty(), "cache: dirty without tables");
+}
+
+// ParseRootSignature sets the bits of descriptor tables only, and binds walk the dirty bits from
+// the lowest root index up
+void TestRootSignatureMasks()
+{
+  ID3D12Device device;
+  dxh::QueueFence fence;
+  dxh::DynamicDescriptorHeap heap{&device, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, fence, 256};
+  ID3D12GraphicsCommandList commandList;
+
+  D3D12_DESCRIPTOR_RANGE range{2};
+  std::vector<D3D12_ROOT_PARAMETER> parameters(
+    DescriptorTableCache::kMaxRootParameters, {D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS, {}}
+  );
+  for (size_t rootIndex : kTableRootIndices) {
+    parameters[rootIndex] = {D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE, {1, &range}};
+  }
+  heap.ParseRootSignature(dxh::RootSignature{parameters});
+
+  std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> handles = {{0x8000}, {0x8020}};
+  for (size_t rootIndex : {63, 32, 1}) {
+    heap.SetDescriptors(static_cast<UINT>(rootIndex), 0, 2, handles.data());
+  }
+  heap.BindModifiedDescriptors(&device, &commandList);
+
+  std::vector<UINT> boundRootIndices;
+  for (const RecordedBind& bind : commandList.binds) {
+    boundRootIndices.push_back(bind.rootIndex);
+  }
+  Expect(
+    boundRootIndices == std::vector<UINT>{1, 32, 63},
+    "masks: dirty tables not bound in root index order"
+  );
+  Expect(
+    device.copies.size() == 1 && device.copies[0].destSize == 6,
+    "masks: copy doesn't cover exactly the dirty tables"
+  );
+
+  // A new frame marks every table dirty, constants stay out
+  heap.FinishFrame(fence.Signal());
+  commandList.binds.clear();
+  heap.BindModifiedDescriptors(&device, &commandList);
+  boundRootIndices.clear();
+  for (const RecordedBind& bind : commandList.binds) {
+    boundRootIndices.push_back(bind.rootIndex);
+  }
+  std::vector<UINT> tableRootIndices(std::begin(kTableRootIndices), std::end(kTableRootIndices));
+  Expect(
+    boundRootIndices == tableRootIndices,
+    "masks: a new frame didn't bind exactly the descriptor tables"
+  );
+}
+
+}  // namespace
+
+void TestDescriptorTableCache()
+{
+  TestDescriptorCount();
+  TestDirtyMask();
+  TestRootSignatureMasks();
+}
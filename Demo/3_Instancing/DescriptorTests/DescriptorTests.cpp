@@ -0,0 +1,60 @@
+// Tests of the descriptor allocators and copies against the stand-in D3D12 types of d3d12stub,
+// run by ctest. The optional argument names the suite to run, all run without one. Exits with 1
+// and prints every failed check
+
+#include "DescriptorTests.h"
+
+#include <iostream>
+#include <string>
+
+namespace
+{
+
+int g_failureCount = 0;
+
+struct Suite {
+  const char* name;
+  void (*run)();
+};
+
+constexpr Suite kSuites[] = {
+  {"DescriptorRangeAllocator", TestDescriptorRangeAllocator},
+  {"DescriptorPool", TestDescriptorPool},
+  {"DescriptorRing", TestDescriptorRing},
+  {"DescriptorCopyBatch", TestDescriptorCopyBatch},
+  {"DescriptorTableCache", TestDescriptorTableCache},
+  {"DynamicDescriptorHeap", TestDynamicDescriptorHeap},
+};
+
+}  // namespace
+
+void Expect(bool condition, const std::string& what)
+{
+  if (!condition) {
+    ++g_failureCount;
+    std::cerr << "FAILED: " << what << "\n";
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  std::string only = argc > 1 ? argv[1] : "";
+  bool found = only.empty();
+  for (const Suite& suite : kSuites) {
+    if (only.empty() || only == suite.name) {
+      suite.run();
+      found = true;
+    }
+  }
+  if (!found) {
+    std::cerr << "Unknown suite " << only << "\n";
+    return 1;
+  }
+
+  if (g_failureCount > 0) {
+    std::cerr << g_failureCount << " checks failed\n";
+    return 1;
+  }
+  std::cout << "All descriptor checks passed\n";
+  return 0;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <string>
+
+// Counts and prints a failed check, main exits with 1 when any failed
+void Expect(bool condition, const std::string& what);
+
+// Suites of DemoDescriptorTests, each registered with ctest by name
+void TestDescriptorRangeAllocator();
+void TestDescriptorPool();
+void TestDescriptorRing();
+void TestDescriptorCopyBatch();
+void TestDescriptorTableCache();
+void TestDynamicDescriptorHeap();
@@ -0,0 +1,310 @@
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "DescriptorHeap.h"
+#include "DescriptorTests.h"
+
+using dxh::DynamicDescriptorHeap;
+
+namespace
+{
+
+constexpr UINT kIncrementSize = ID3D12Device::kIncrementSize;
+constexpr UINT kTableSize = 3;
+
+// Source handles of table `set`, distinct sets don't share handles
+std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> TableHandles(size_t set)
+{
+  std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> handles;
+  for (UINT i = 0; i < kTableSize; ++i) {
+    handles.push_back({0x8000 + set * 0x100 + i * kIncrementSize});
+  }
+  return handles;
+}
+
+// Shader-visible heap of one DynamicDescriptorHeap as the GPU sees it. Follows the recorded copies
+// and binds, and fails a check when a copy overwrites slots that a frame the fence hasn't passed
+// reads, or when a table is bound to slots that don't hold its handles
+class GPUModel
+{
+public:
+  GPUModel(
+    ID3D12Device& device,
+    ID3D12GraphicsCommandList& commandList,
+    dxh::QueueFence& fence,
+    UINT capacity
+  )
+      : device{device},
+        commandList{commandList},
+        fence{fence},
+        cpuStart{device.heapCount * ID3D12Device::kHeapSpacing},
+        slotSources(capacity, 0)
+  {
+  }
+
+  // Call after BindModifiedDescriptors with the handles each root index was set to
+  void AfterBind(const std::vector<std::vector<D3D12_CPU_DESCRIPTOR_HANDLE>>& rootHandles)
+  {
+    for (; copyCount < device.copies.size(); ++copyCount) {
+      ApplyCopy(device.copies[copyCount]);
+    }
+    for (; bindCount < commandList.binds.size(); ++bindCount) {
+      ApplyBind(commandList.binds[bindCount], rootHandles);
+    }
+  }
+
+  // Reads of the current frame complete with `fenceValue`
+  void FinishFrame(uint64_t fenceValue)
+  {
+    for (Read& read : reads) {
+      if (read.fenceValue == 0) {
+        read.fenceValue = fenceValue;
+      }
+    }
+  }
+
+  size_t CopyCount() const { return copyCount; }
+  size_t BindCount() const { return bindCount; }
+
+private:
+  // Slots a frame reads, fenceValue is 0 while the frame is recorded
+  struct Read {
+    uint64_t fenceValue;
+    UINT offset;
+    UINT count;
+  };
+
+  void ApplyCopy(const RecordedCopy& copy)
+  {
+    auto offset = static_cast<UINT>((copy.dest.ptr - cpuStart) / kIncrementSize);
+    reads.erase(
+      std::remove_if(
+        reads.begin(), reads.end(),
+        [&](const Read& read) {
+          return read.fenceValue != 0 && read.fenceValue <= fence.CompletedValue();
+        }
+      ),
+      reads.end()
+    );
+    for (const Read& read : reads) {
+      bool overlaps = offset < read.offset + read.count && read.offset < offset + copy.destSize;
+      Expect(
+        !overlaps, "GPU model: copy to slots " + std::to_string(offset) + " to " +
+                     std::to_string(offset + copy.destSize - 1) + " overwrote a table of " +
+                     (read.fenceValue == 0 ? std::string{"the current frame"}
+                                           : "fence value " + std::to_string(read.fenceValue))
+      );
+    }
+
+    UINT slot = offset;
+    for (size_t range = 0; range < copy.srcStarts.size(); ++range) {
+      for (UINT i = 0; i < copy.srcSizes[range]; ++i) {
+        slotSources[slot++] = copy.srcStarts[range].ptr + SIZE_T{i} * kIncrementSize;
+      }
+    }
+  }
+
+  void ApplyBind(
+    const RecordedBind& bind,
+    const std::vector<std::vector<D3D12_CPU_DESCRIPTOR_HANDLE>>& rootHandles
+  )
+  {
+    UINT64 gpuStart = cpuStart + ID3D12Device::kGPUAddressOffset;
+    auto offset = static_cast<UINT>((bind.table.ptr - gpuStart) / kIncrementSize);
+    const std::vector<D3D12_CPU_DESCRIPTOR_HANDLE>& expected = rootHandles[bind.rootIndex];
+    bool inside = offset + expected.size() <= slotSources.size();
+    bool matches = inside && std::equal(
+                               expected.begin(), expected.end(), slotSources.begin() + offset,
+                               [](D3D12_CPU_DESCRIPTOR_HANDLE handle, SIZE_T source) {
+                                 return handle.ptr == source;
+                               }
+                             );
+    Expect(
+      matches, "GPU model: root " + std::to_string(bind.rootIndex) + " bound to slot " +
+                 std::to_string(offset) + " that doesn't hold its handles"
+    );
+    reads.push_back({0, offset, static_cast<UINT>(expected.size())});
+  }
+
+  ID3D12Device& device;
+  ID3D12GraphicsCommandList& commandList;
+  dxh::QueueFence& fence;
+  SIZE_T cpuStart;
+  std::vector<SIZE_T> slotSources;
+  std::vector<Read> reads;
+  size_t copyCount = 0;
+  size_t bindCount = 0;
+};
+
+// One DynamicDescriptorHeap with table reuse, `tableCount` tables of kTableSize descriptors and a
+// GPU model following it
+struct ReuseFixture {
+  ReuseFixture(UINT capacity, UINT tableCount)
+      : heap{&device, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, fence, capacity},
+        gpu{device, commandList, fence, capacity},
+        rootHandles(tableCount)
+  {
+    std::vector<D3D12_ROOT_PARAMETER> parameters(
+      tableCount, {D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE, {1, &range}}
+    );
+    heap.ParseRootSignature(dxh::RootSignature{parameters});
+    heap.EnableTableReuse(true);
+  }
+
+  void Set(UINT rootIndex, size_t set)
+  {
+    rootHandles[rootIndex] = TableHandles(set);
+    heap.SetDescriptors(rootIndex, 0, kTableSize, rootHandles[rootIndex].data());
+  }
+
+  void Bind()
+  {
+    heap.BindModifiedDescriptors(&device, &commandList);
+    gpu.AfterBind(rootHandles);
+  }
+
+  // Sets root 0 to `set` and binds it, returns the slot it was bound to
+  UINT BindTable(size_t set)
+  {
+    Set(0, set);
+    Bind();
+    return LastBoundSlot();
+  }
+
+  UINT LastBoundSlot() const
+  {
+    UINT64 gpuStart = device.heapCount * ID3D12Device::kHeapSpacing;
+    gpuStart += ID3D12Device::kGPUAddressOffset;
+    return static_cast<UINT>((commandList.binds.back().table.ptr - gpuStart) / kIncrementSize);
+  }
+
+  uint64_t FinishFrame()
+  {
+    uint64_t fenceValue = fence.Signal();
+    heap.FinishFrame(fenceValue);
+    gpu.FinishFrame(fenceValue);
+    return fenceValue;
+  }
+
+  ID3D12Device device;
+  ID3D12GraphicsCommandList commandList;
+  dxh::QueueFence fence;
+  D3D12_DESCRIPTOR_RANGE range{kTableSize};
+  DynamicDescriptorHeap heap;
+  GPUModel gpu;
+  std::vector<std::vector<D3D12_CPU_DESCRIPTOR_HANDLE>> rootHandles;
+};
+
+// A frame that binds an earlier frame's copy keeps it until the reusing frame completes, even once
+// the frame that made the copy completed
+void TestRetainedCopyKept()
+{
+  ReuseFixture fixture{16, 1};
+  UINT copied = fixture.BindTable(0);
+  fixture.FinishFrame();
+
+  Expect(fixture.BindTable(0) == copied, "retain: copy of the previous frame not reused");
+  Expect(fixture.gpu.CopyCount() == 1, "retain: reused table copied again");
+  uint64_t reusingFrame = fixture.FinishFrame();
+  fixture.fence.Complete(reusingFrame - 1);
+
+  // Fills the rest of the lap, then needs the copied slots
+  for (size_t set = 1; set <= 5; ++set) {
+    fixture.BindTable(set);
+  }
+  const std::vector<uint64_t>& waited = fixture.fence.WaitedValues();
+  Expect(
+    std::find(waited.begin(), waited.end(), reusingFrame) != waited.end(),
+    "retain: copied slots written again without waiting for the frame that reused them"
+  );
+}
+
+// Copies of the previous ring lap are never bound again, the new lap writes over their slots
+void TestCopiesDroppedOnLap()
+{
+  ReuseFixture fixture{16, 1};
+  UINT copied = fixture.BindTable(0);
+  Expect(fixture.BindTable(0) == copied, "lap: copy of the same lap not reused");
+  for (size_t set = 1; set <= 4; ++set) {
+    fixture.BindTable(set);
+  }
+  fixture.fence.Complete(fixture.FinishFrame());
+  size_t copiesBeforeLap = fixture.gpu.CopyCount();
+
+  // Goes back to the start of the heap, over the first copy
+  Expect(fixture.BindTable(5) == copied, "lap: new lap didn't start at the first copy");
+  Expect(fixture.heap.Ring().Lap() == 1, "lap: ring didn't start a new lap");
+  fixture.BindTable(0);
+  Expect(
+    fixture.gpu.CopyCount() == copiesBeforeLap + 2,
+    "lap: copy of the previous lap bound again instead of copying"
+  );
+}
+
+// InvalidateCopiedTables makes the next bind copy every table again, even without new handles
+void TestInvalidateCopies()
+{
+  ReuseFixture fixture{64, 2};
+  fixture.Set(0, 0);
+  fixture.Set(1, 1);
+  fixture.Bind();
+  fixture.fence.Complete(fixture.FinishFrame());
+  fixture.Set(0, 0);
+  fixture.Set(1, 1);
+  fixture.Bind();
+  Expect(fixture.gpu.CopyCount() == 1, "invalidate: unchanged tables copied again");
+
+  fixture.heap.InvalidateCopiedTables();
+  size_t bindsBefore = fixture.gpu.BindCount();
+  fixture.Bind();
+  Expect(fixture.gpu.CopyCount() == 2, "invalidate: bind after invalidating didn't copy");
+  Expect(
+    fixture.gpu.BindCount() == bindsBefore + 2, "invalidate: tables not bound again after copying"
+  );
+
+  // Reuse picks up the new copies
+  fixture.fence.Complete(fixture.FinishFrame());
+  fixture.Set(0, 0);
+  fixture.Set(1, 1);
+  fixture.Bind();
+  Expect(fixture.gpu.CopyCount() == 2, "invalidate: new copies not reused");
+}
+
+// Random tables over many laps with the GPU up to two frames behind, the model checks every copy
+// and bind
+void TestRandomFrames()
+{
+  ReuseFixture fixture{48, 2};
+  std::mt19937 rng{25};
+  size_t reusedBindCount = 0;
+  for (int frame = 0; frame < 2'000; ++frame) {
+    size_t setCount = frame < 1'000 ? 4 : 12;
+    for (int draw = 0; draw < 4; ++draw) {
+      for (UINT rootIndex = 0; rootIndex < 2; ++rootIndex) {
+        fixture.Set(rootIndex, rng() % setCount);
+      }
+      size_t copiesBefore = fixture.gpu.CopyCount();
+      fixture.Bind();
+      reusedBindCount += fixture.gpu.CopyCount() == copiesBefore;
+      if (rng() % 16 == 0) {
+        fixture.heap.InvalidateCopiedTables();
+      }
+    }
+    uint64_t fenceValue = fixture.FinishFrame();
+    fixture.fence.Complete(fenceValue - std::min<uint64_t>(fenceValue, rng() % 3));
+  }
+  Expect(reusedBindCount > 0, "random: no bind reused a copy");
+  Expect(fixture.heap.Ring().Lap() > 10, "random: too few ring laps to check");
+}
+
+}  // namespace
+
+void TestDynamicDescriptorHeap()
+{
+  TestRetainedCopyKept();
+  TestCopiesDroppedOnLap();
+  TestInvalidateCopies();
+  TestRandomFrames();
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+// Stand-in for DX12Helper/Fence.h in the descriptor tests. The GPU is simulated by the test: the
+// completed value moves on Complete, and waiting on a value completes up to it
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace dxh
+{
+
+class QueueFence
+{
+public:
+  uint64_t Signal() { return ++signaledValue; }
+  uint64_t CompletedValue() const { return completedValue; }
+
+  void WaitForValue(uint64_t value)
+  {
+    waitedValues.push_back(value);
+    Complete(value);
+  }
+
+  void Complete(uint64_t value) { completedValue = std::max(completedValue, value); }
+
+  const std::vector<uint64_t>& WaitedValues() const { return waitedValues; }
+
+private:
+  uint64_t signaledValue = 0;
+  uint64_t completedValue = 0;
+  std::vector<uint64_t> waitedValues;
+};
+
+}  // namespace dxh
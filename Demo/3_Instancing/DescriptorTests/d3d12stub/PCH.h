@@ -0,0 +1,238 @@
+#pragma once
+
+// Stand-in for DX12Helper/PCH.h in the descriptor tests. Declares only the D3D12 types the
+// descriptor headers use, with a device that hands out heaps at made up addresses and records
+// descriptor copies, and a command list that records table binds. Nothing touches a GPU
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using UINT = uint32_t;
+using INT = int32_t;
+using UINT64 = uint64_t;
+using SIZE_T = size_t;
+using ULONG = unsigned long;
+using HRESULT = long;
+
+struct D3D12_CPU_DESCRIPTOR_HANDLE {
+  SIZE_T ptr;
+};
+
+struct D3D12_GPU_DESCRIPTOR_HANDLE {
+  UINT64 ptr;
+};
+
+struct CD3DX12_CPU_DESCRIPTOR_HANDLE : D3D12_CPU_DESCRIPTOR_HANDLE {
+  CD3DX12_CPU_DESCRIPTOR_HANDLE(D3D12_CPU_DESCRIPTOR_HANDLE base, INT index, UINT incrementSize)
+      : D3D12_CPU_DESCRIPTOR_HANDLE{base.ptr + static_cast<SIZE_T>(index) * incrementSize}
+  {
+  }
+};
+
+struct CD3DX12_GPU_DESCRIPTOR_HANDLE : D3D12_GPU_DESCRIPTOR_HANDLE {
+  CD3DX12_GPU_DESCRIPTOR_HANDLE(D3D12_GPU_DESCRIPTOR_HANDLE base, INT index, UINT incrementSize)
+      : D3D12_GPU_DESCRIPTOR_HANDLE{base.ptr + static_cast<UINT64>(index) * incrementSize}
+  {
+  }
+};
+
+enum D3D12_DESCRIPTOR_HEAP_TYPE {
+  D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV,
+  D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER,
+  D3D12_DESCRIPTOR_HEAP_TYPE_RTV,
+  D3D12_DESCRIPTOR_HEAP_TYPE_DSV
+};
+
+enum D3D12_DESCRIPTOR_HEAP_FLAGS {
+  D3D12_DESCRIPTOR_HEAP_FLAG_NONE = 0,
+  D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE = 1
+};
+
+struct D3D12_DESCRIPTOR_HEAP_DESC {
+  D3D12_DESCRIPTOR_HEAP_TYPE Type;
+  UINT NumDescriptors;
+  D3D12_DESCRIPTOR_HEAP_FLAGS Flags;
+  UINT NodeMask;
+};
+
+enum D3D12_ROOT_PARAMETER_TYPE {
+  D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE,
+  D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS,
+  D3D12_ROOT_PARAMETER_TYPE_CBV
+};
+
+struct D3D12_DESCRIPTOR_RANGE {
+  UINT NumDescriptors;
+};
+
+struct D3D12_ROOT_DESCRIPTOR_TABLE {
+  UINT NumDescriptorRanges;
+  const D3D12_DESCRIPTOR_RANGE* pDescriptorRanges;
+};
+
+struct D3D12_ROOT_PARAMETER {
+  D3D12_ROOT_PARAMETER_TYPE ParameterType;
+  D3D12_ROOT_DESCRIPTOR_TABLE DescriptorTable;
+};
+
+// Reference counted like a COM object, so ComPtr copies share it
+class ID3D12DescriptorHeap
+{
+public:
+  ID3D12DescriptorHeap(const D3D12_DESCRIPTOR_HEAP_DESC& desc, SIZE_T cpuStart, UINT64 gpuStart)
+      : desc{desc},
+        cpuStart{cpuStart},
+        gpuStart{gpuStart}
+  {
+  }
+
+  ULONG AddRef() { return ++refCount; }
+
+  ULONG Release()
+  {
+    ULONG count = --refCount;
+    if (count == 0) {
+      delete this;
+    }
+    return count;
+  }
+
+  D3D12_DESCRIPTOR_HEAP_DESC GetDesc() const { return desc; }
+  D3D12_CPU_DESCRIPTOR_HANDLE GetCPUDescriptorHandleForHeapStart() const { return {cpuStart}; }
+  D3D12_GPU_DESCRIPTOR_HANDLE GetGPUDescriptorHandleForHeapStart() const { return {gpuStart}; }
+
+private:
+  D3D12_DESCRIPTOR_HEAP_DESC desc;
+  SIZE_T cpuStart;
+  UINT64 gpuStart;
+  ULONG refCount = 1;
+};
+
+// One CopyDescriptors call with a single destination range
+struct RecordedCopy {
+  D3D12_CPU_DESCRIPTOR_HANDLE dest;
+  UINT destSize;
+  std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> srcStarts;
+  std::vector<UINT> srcSizes;
+  D3D12_DESCRIPTOR_HEAP_TYPE type;
+};
+
+class ID3D12Device
+{
+public:
+  static constexpr UINT kIncrementSize = 32;
+  // Heaps are this far apart, more than any test heap spans
+  static constexpr SIZE_T kHeapSpacing = SIZE_T{1} << 20;
+  static constexpr UINT64 kGPUAddressOffset = UINT64{1} << 40;
+
+  UINT GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE) const { return kIncrementSize; }
+
+  HRESULT CreateDescriptorHeap(const D3D12_DESCRIPTOR_HEAP_DESC* desc, ID3D12DescriptorHeap** heap)
+  {
+    SIZE_T cpuStart = ++heapCount * kHeapSpacing;
+    *heap = new ID3D12DescriptorHeap{*desc, cpuStart, cpuStart + kGPUAddressOffset};
+    return 0;
+  }
+
+  void CopyDescriptors(
+    UINT destRangeCount,
+    const D3D12_CPU_DESCRIPTOR_HANDLE* destStarts,
+    const UINT* destSizes,
+    UINT srcRangeCount,
+    const D3D12_CPU_DESCRIPTOR_HANDLE* srcStarts,
+    const UINT* srcSizes,
+    D3D12_DESCRIPTOR_HEAP_TYPE type
+  )
+  {
+    assert(destRangeCount == 1 && "The descriptor code copies to one destination range");
+    (void)destRangeCount;
+    copies.push_back(
+      {destStarts[0], destSizes[0], {srcStarts, srcStarts + srcRangeCount},
+       {srcSizes, srcSizes + srcRangeCount}, type}
+    );
+  }
+
+  SIZE_T heapCount = 0;
+  std::vector<RecordedCopy> copies;
+};
+
+// One SetGraphicsRootDescriptorTable call
+struct RecordedBind {
+  UINT rootIndex;
+  D3D12_GPU_DESCRIPTOR_HANDLE table;
+};
+
+class ID3D12GraphicsCommandList
+{
+public:
+  void SetDescriptorHeaps(UINT heapCount, ID3D12DescriptorHeap* const* heaps)
+  {
+    boundHeaps.assign(heaps, heaps + heapCount);
+  }
+
+  void SetGraphicsRootDescriptorTable(UINT rootIndex, D3D12_GPU_DESCRIPTOR_HANDLE table)
+  {
+    binds.push_back({rootIndex, table});
+  }
+
+  std::vector<ID3D12DescriptorHeap*> boundHeaps;
+  std::vector<RecordedBind> binds;
+};
+
+namespace Microsoft::WRL
+{
+
+template<typename T>
+class ComPtr
+{
+public:
+  ComPtr() = default;
+  ComPtr(const ComPtr& other) : ptr{other.ptr}
+  {
+    if (ptr) {
+      ptr->AddRef();
+    }
+  }
+  ComPtr(ComPtr&& other) noexcept : ptr{std::exchange(other.ptr, nullptr)} {}
+  ComPtr& operator=(ComPtr other) noexcept
+  {
+    std::swap(ptr, other.ptr);
+    return *this;
+  }
+  ~ComPtr()
+  {
+    if (ptr) {
+      ptr->Release();
+    }
+  }
+
+  T* Get() const { return ptr; }
+  T* operator->() const { return ptr; }
+  T** GetAddressOf() { return &ptr; }
+
+private:
+  T* ptr = nullptr;
+};
+
+}  // namespace Microsoft::WRL
+
+namespace DX
+{
+
+inline void ThrowIfFailed(HRESULT hr)
+{
+  if (hr < 0) {
+    throw std::runtime_error{"D3D12 call failed"};
+  }
+}
+
+}  // namespace DX
+
+#define IID_PPV_ARGS(ppType) ppType
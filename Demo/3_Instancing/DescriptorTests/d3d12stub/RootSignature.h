@@ -0,0 +1,28 @@
+#pragma once
+
+// Stand-in for DX12Helper/RootSignature.h in the descriptor tests, keeps the parameters without
+// serializing them
+
+#include <vector>
+
+#include "PCH.h"
+
+namespace dxh
+{
+
+class RootSignature
+{
+public:
+  explicit RootSignature(std::vector<D3D12_ROOT_PARAMETER> parameters)
+      : rootParameters{std::move(parameters)}
+  {
+  }
+
+  D3D12_ROOT_PARAMETER Parameter(size_t index) const { return rootParameters[index]; }
+  size_t ParameterCount() const { return rootParameters.size(); }
+
+private:
+  std::vector<D3D12_ROOT_PARAMETER> rootParameters;
+};
+
+}  // namespace dxh
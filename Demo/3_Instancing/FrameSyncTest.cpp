@@ -0,0 +1,222 @@
+// Tests of dxh::FrameSync against a fence completed by hand, run by ctest. Exits with 1 and prints
+// every failed check
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FrameSync.h"
+
+namespace
+{
+
+// Frames in flight of RenderContext.h, which needs D3D12 and isn't included here
+constexpr size_t kFramesInFlight = 2;
+
+int g_failureCount = 0;
+
+void Expect(bool condition, const std::string& what)
+{
+  if (!condition) {
+    ++g_failureCount;
+    std::cerr << "FAILED: " << what << "\n";
+  }
+}
+
+// Fence whose completed value only moves on Complete. WaitForValue blocks until it does
+class ManualFence
+{
+public:
+  uint64_t Signal()
+  {
+    std::lock_guard lock{mutex};
+    return ++signaledValue;
+  }
+
+  uint64_t CompletedValue() const
+  {
+    std::lock_guard lock{mutex};
+    return completedValue;
+  }
+
+  void WaitForValue(uint64_t value)
+  {
+    std::unique_lock lock{mutex};
+    waitedValues.push_back(value);
+    ++waiterCount;
+    completed.wait(lock, [&]() { return completedValue >= value; });
+    --waiterCount;
+  }
+
+  void Complete(uint64_t value)
+  {
+    std::lock_guard lock{mutex};
+    completedValue = std::max(completedValue, value);
+    completed.notify_all();
+  }
+
+  uint64_t SignaledValue() const
+  {
+    std::lock_guard lock{mutex};
+    return signaledValue;
+  }
+
+  std::vector<uint64_t> WaitedValues() const
+  {
+    std::lock_guard lock{mutex};
+    return waitedValues;
+  }
+
+  // Spins until a thread is blocked in WaitForValue, false if none is within `timeout`
+  bool WaitForWaiter(std::chrono::milliseconds timeout = std::chrono::seconds{2}) const
+  {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (std::chrono::steady_clock::now() < deadline) {
+      {
+        std::lock_guard lock{mutex};
+        if (waiterCount > 0) {
+          return true;
+        }
+      }
+      std::this_thread::yield();
+    }
+    return false;
+  }
+
+private:
+  mutable std::mutex mutex;
+  std::condition_variable completed;
+  uint64_t signaledValue = 0;
+  uint64_t completedValue = 0;
+  std::vector<uint64_t> waitedValues;
+  size_t waiterCount = 0;
+};
+
+std::string FramesName(size_t frameCount)
+{
+  return std::to_string(frameCount) + " frames: ";
+}
+
+// Every EndFrame signals a larger value than the last one, and walking the slots from the current
+// one (the oldest submission) gives rising values
+template<size_t frameCount>
+void TestFenceValuesRise()
+{
+  std::string name = FramesName(frameCount);
+  ManualFence fence;
+  dxh::FrameSync<ManualFence, frameCount> frameSync{fence};
+
+  uint64_t lastValue = 0;
+  for (size_t frame = 0; frame < 5 * frameCount; ++frame) {
+    size_t slot = frameSync.CurrentFrame();
+    Expect(slot == frame % frameCount, name + "slot " + std::to_string(slot) + " out of order");
+    frameSync.BeginFrame();
+    uint64_t value = frameSync.EndFrame();
+    Expect(value > lastValue, name + "fence value " + std::to_string(value) + " didn't rise");
+    Expect(frameSync.FrameFenceValue(slot) == value, name + "slot doesn't keep its fence value");
+    lastValue = value;
+
+    size_t submittedCount = std::min(frame + 1, frameCount);
+    size_t oldest = (frameSync.CurrentFrame() + frameCount - submittedCount) % frameCount;
+    for (size_t k = 1; k < submittedCount; ++k) {
+      size_t older = (oldest + k - 1) % frameCount;
+      size_t newer = (oldest + k) % frameCount;
+      Expect(
+        frameSync.FrameFenceValue(older) < frameSync.FrameFenceValue(newer),
+        name + "slots " + std::to_string(older) + " and " + std::to_string(newer) +
+          " out of submission order"
+      );
+    }
+    // Let the GPU keep up so BeginFrame never blocks here
+    fence.Complete(value);
+  }
+  Expect(fence.WaitedValues().empty(), name + "waited on completed frames");
+}
+
+// BeginFrame on a slot still in flight blocks until the fence reaches the value signaled after
+// that slot's last use, values of other slots don't release it
+template<size_t frameCount>
+void TestBeginFrameBlocks()
+{
+  std::string name = FramesName(frameCount);
+  ManualFence fence;
+  dxh::FrameSync<ManualFence, frameCount> frameSync{fence};
+
+  // Slots never submitted don't wait
+  for (size_t frame = 0; frame < frameCount; ++frame) {
+    frameSync.BeginFrame();
+    frameSync.EndFrame();
+  }
+  Expect(fence.WaitedValues().empty(), name + "waited on a slot never submitted");
+
+  for (size_t round = 0; round < 2 * frameCount; ++round) {
+    size_t slot = frameSync.CurrentFrame();
+    uint64_t slotValue = frameSync.FrameFenceValue(slot);
+    std::string slotName = name + "slot " + std::to_string(slot) + ": ";
+    Expect(!frameSync.IsFrameComplete(slot), slotName + "complete before the fence reached it");
+
+    std::atomic<bool> begun{false};
+    std::thread frameThread{[&]() {
+      frameSync.BeginFrame();
+      begun = true;
+    }};
+    Expect(fence.WaitForWaiter(), slotName + "BeginFrame didn't block");
+    std::vector<uint64_t> waitedValues = fence.WaitedValues();
+    Expect(
+      !waitedValues.empty() && waitedValues.back() == slotValue,
+      slotName + "didn't wait for its own fence value"
+    );
+
+    // One short of the slot's value keeps BeginFrame blocked
+    fence.Complete(slotValue - 1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    Expect(!begun, slotName + "BeginFrame returned before the fence reached the slot");
+
+    fence.Complete(slotValue);
+    frameThread.join();
+    Expect(begun, slotName + "BeginFrame didn't return");
+    Expect(frameSync.IsFrameComplete(slot), slotName + "not complete after its value");
+    for (size_t other = 0; other < frameCount; ++other) {
+      if (other != slot) {
+        Expect(
+          !frameSync.IsFrameComplete(other),
+          slotName + "slot " + std::to_string(other) + " complete before the fence reached it"
+        );
+      }
+    }
+    frameSync.EndFrame();
+  }
+
+  // WaitForAllFrames returns once the newest submission completed
+  std::thread drainThread{[&]() { frameSync.WaitForAllFrames(); }};
+  Expect(fence.WaitForWaiter(), name + "WaitForAllFrames didn't block");
+  fence.Complete(fence.SignaledValue());
+  drainThread.join();
+  for (size_t frame = 0; frame < frameCount; ++frame) {
+    Expect(frameSync.IsFrameComplete(frame), name + "slot in flight after WaitForAllFrames");
+  }
+}
+
+}  // namespace
+
+int main()
+{
+  TestFenceValuesRise<kFramesInFlight>();
+  TestFenceValuesRise<3>();
+  TestBeginFrameBlocks<kFramesInFlight>();
+  TestBeginFrameBlocks<3>();
+
+  if (g_failureCount > 0) {
+    std::cerr << g_failureCount << " checks failed\n";
+    return 1;
+  }
+  std::cout << "All frame sync checks passed\n";
+  return 0;
+}
@@ -0,0 +1,153 @@
+#include "InstanceFormats.h"
+
+#include "JobSystem.h"
+
+using namespace DirectX;
+
+InstanceFormat g_instanceFormat = InstanceFormat::Affine;
+
+size_t InstanceFormatStride(InstanceFormat format)
+{
+  switch (format) {
+    case InstanceFormat::Affine:
+      return sizeof(InstanceDataAffine);
+    case InstanceFormat::QuatPosScale:
+      return sizeof(InstanceDataQuatPosScale);
+    default:
+      return sizeof(InstanceData);
+  }
+}
+
+const char* InstanceFormatName(InstanceFormat format)
+{
+  switch (format) {
+    case InstanceFormat::Affine:
+      return "Affine3x4";
+    case InstanceFormat::QuatPosScale:
+      return "QuatPosScale";
+    default:
+      return "Full";
+  }
+}
+
+uint32_t PackAlbedoRGBA8(const XMFLOAT4& albedo)
+{
+  // Saturated and rounded, x lands in the lowest byte
+  PackedVector::XMUBYTEN4 packed;
+  PackedVector::XMStoreUByteN4(&packed, XMLoadFloat4(&albedo));
+  return packed.v;
+}
+
+XMFLOAT4 UnpackAlbedoRGBA8(uint32_t albedo)
+{
+  PackedVector::XMUBYTEN4 packed{albedo};
+  XMFLOAT4 res;
+  XMStoreFloat4(&res, PackedVector::XMLoadUByteN4(&packed));
+  return res;
+}
+
+void PackInstance(const InstanceData& instance, InstanceDataAffine& packed)
+{
+  XMMATRIX world = XMLoadFloat4x4(&instance.world);
+  XMStoreFloat3x4(&packed.world, world);
+  packed.albedo = PackAlbedoRGBA8(instance.albedo);
+}
+
+void PackInstance(const InstanceData& instance, InstanceDataQuatPosScale& packed)
+{
+  XMMATRIX world = XMLoadFloat4x4(&instance.world);
+  XMVECTOR scale = XMVector3Length(world.r[0]);
+  // A mirrored basis keeps a proper rotation with a negative scale
+  XMVECTOR determinant = XMVector3Dot(XMVector3Cross(world.r[0], world.r[1]), world.r[2]);
+  if (XMVectorGetX(determinant) < 0.f) {
+    scale = XMVectorNegate(scale);
+  }
+  XMVECTOR invScale = XMVectorReciprocal(scale);
+
+  XMMATRIX rotation;
+  rotation.r[0] = XMVectorMultiply(world.r[0], invScale);
+  rotation.r[1] = XMVectorMultiply(world.r[1], invScale);
+  rotation.r[2] = XMVectorMultiply(world.r[2], invScale);
+  rotation.r[3] = XMVectorSet(0.f, 0.f, 0.f, 1.f);
+
+  XMStoreFloat4(&packed.rotation, XMQuaternionRotationMatrix(rotation));
+  XMStoreFloat3(&packed.position, world.r[3]);
+  packed.scale = XMVectorGetX(scale);
+  packed.albedo = PackAlbedoRGBA8(instance.albedo);
+}
+
+namespace
+{
+
+InstanceData InstanceFromWorld(FXMMATRIX world, uint32_t albedo)
+{
+  InstanceData instance;
+  XMStoreFloat4x4(&instance.world, world);
+  XMStoreFloat4x4(&instance.invWorld, XMMatrixInverse(nullptr, world));
+  instance.albedo = UnpackAlbedoRGBA8(albedo);
+  return instance;
+}
+
+void PackInstance(const InstanceData& instance, InstanceData& packed) { packed = instance; }
+
+template<typename PackedType>
+void PackInstanceRange(
+  const InstanceData* instances,
+  const size_t* indices,
+  size_t first,
+  size_t last,
+  PackedType* dst
+)
+{
+  for (size_t k = first; k < last; ++k) {
+    PackInstance(instances[indices ? indices[k] : k], dst[k]);
+  }
+}
+
+}  // namespace
+
+InstanceData UnpackInstance(const InstanceDataAffine& packed)
+{
+  return InstanceFromWorld(XMLoadFloat3x4(&packed.world), packed.albedo);
+}
+
+InstanceData UnpackInstance(const InstanceDataQuatPosScale& packed)
+{
+  XMMATRIX rotation = XMMatrixRotationQuaternion(XMLoadFloat4(&packed.rotation));
+  XMMATRIX world = XMMatrixScaling(packed.scale, packed.scale, packed.scale) * rotation;
+  world.r[3] = XMVectorSetW(XMLoadFloat3(&packed.position), 1.f);
+  return InstanceFromWorld(world, packed.albedo);
+}
+
+void PackInstances(
+  InstanceFormat format,
+  const InstanceData* instances,
+  const size_t* indices,
+  size_t count,
+  void* dst
+)
+{
+  // Large enough to keep task overhead well below the cost of packing
+  constexpr size_t kMinGrain = 4096;
+
+  auto packAs = [&](auto* typedDst) {
+    dxh::JobSystem::Shared().ParallelFor(
+      0, count,
+      [&](size_t first, size_t last) {
+        PackInstanceRange(instances, indices, first, last, typedDst);
+      },
+      kMinGrain
+    );
+  };
+  switch (format) {
+    case InstanceFormat::Affine:
+      packAs(static_cast<InstanceDataAffine*>(dst));
+      break;
+    case InstanceFormat::QuatPosScale:
+      packAs(static_cast<InstanceDataQuatPosScale*>(dst));
+      break;
+    default:
+      packAs(static_cast<InstanceData*>(dst));
+      break;
+  }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+
+#include "Instances.h"
+
+// GPU layouts of InstanceData. The vertex shader is compiled once per format with INSTANCE_FORMAT
+// set to its value
+enum class InstanceFormat : uint8_t {
+  Full,          // InstanceData as is, 144 bytes
+  Affine,        // InstanceDataAffine, 52 bytes
+  QuatPosScale,  // InstanceDataQuatPosScale, 36 bytes
+  Count
+};
+
+// Transposed 3x4 world matrix, the last column (0, 0, 0, 1) is implied and the inverse is left to
+// the shader. Albedo as RGBA8
+struct InstanceDataAffine {
+  DirectX::XMFLOAT3X4 world;
+  uint32_t albedo;
+};
+
+// Rigid transform with uniform scale, world = scale * rotation followed by the translation. A
+// negative scale mirrors. Albedo as RGBA8
+struct InstanceDataQuatPosScale {
+  DirectX::XMFLOAT4 rotation;
+  DirectX::XMFLOAT3 position;
+  float scale;
+  uint32_t albedo;
+};
+
+// Format of the instance buffer, cycled with 'F'
+extern InstanceFormat g_instanceFormat;
+
+size_t InstanceFormatStride(InstanceFormat format);
+const char* InstanceFormatName(InstanceFormat format);
+
+uint32_t PackAlbedoRGBA8(const DirectX::XMFLOAT4& albedo);
+DirectX::XMFLOAT4 UnpackAlbedoRGBA8(uint32_t albedo);
+
+void PackInstance(const InstanceData& instance, InstanceDataAffine& packed);
+// Assumes a rotation with uniform scale, possibly mirrored. Shear and non-uniform scale are lost
+void PackInstance(const InstanceData& instance, InstanceDataQuatPosScale& packed);
+
+// Rebuilds world, invWorld and albedo up to quantization
+InstanceData UnpackInstance(const InstanceDataAffine& packed);
+InstanceData UnpackInstance(const InstanceDataQuatPosScale& packed);
+
+// Writes instances[indices[k]], or instances[k] when `indices` is null, as element k of `dst` in
+// `format`. Ranges are packed in parallel on the shared job system
+void PackInstances(
+  InstanceFormat format,
+  const InstanceData* instances,
+  const size_t* indices,
+  size_t count,
+  void* dst
+);
@@ -0,0 +1,226 @@
+// Round trip tests of the compact instance formats against InstanceData, run by ctest. Exits with
+// 1 and prints every failed check
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "InstanceFormats.h"
+#include "JobSystem.h"
+
+using namespace DirectX;
+
+namespace
+{
+
+// The affine format stores the world matrix as is
+constexpr float kAffineWorldTolerance = 0.f;
+// Quaternion rotation and uniform scale, relative to the largest entry of the linear part
+constexpr float kQuatWorldTolerance = 1e-6f;
+// world * invWorld against the identity
+constexpr float kInverseTolerance = 1e-5f;
+// RGBA8 rounds to the nearest of 255 steps
+constexpr float kAlbedoTolerance = 0.5f / 255.f + 1e-6f;
+
+int g_failureCount = 0;
+
+void Expect(bool condition, const std::string& what)
+{
+  if (!condition) {
+    ++g_failureCount;
+    std::cerr << "FAILED: " << what << "\n";
+  }
+}
+
+float MaxAbsDifference(const XMFLOAT4X4& a, const XMFLOAT4X4& b)
+{
+  float res = 0.f;
+  for (int i = 0; i < 4; ++i) {
+    for (int j = 0; j < 4; ++j) {
+      res = std::max(res, std::fabs(a.m[i][j] - b.m[i][j]));
+    }
+  }
+  return res;
+}
+
+float MaxAbsLinearEntry(const XMFLOAT4X4& m)
+{
+  float res = 0.f;
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 3; ++j) {
+      res = std::max(res, std::fabs(m.m[i][j]));
+    }
+  }
+  return res;
+}
+
+float MaxAbsDifference(const XMFLOAT4& a, const XMFLOAT4& b)
+{
+  return std::max(
+    {std::fabs(a.x - b.x), std::fabs(a.y - b.y), std::fabs(a.z - b.z), std::fabs(a.w - b.w)}
+  );
+}
+
+struct NamedWorld {
+  std::string name;
+  XMMATRIX world;
+  bool rigid;  // Rotation with uniform scale, possibly mirrored, the quaternion format keeps it
+};
+
+InstanceData MakeInstance(FXMMATRIX world, const XMFLOAT4& albedo)
+{
+  InstanceData instance;
+  XMStoreFloat4x4(&instance.world, world);
+  XMStoreFloat4x4(&instance.invWorld, XMMatrixInverse(nullptr, world));
+  instance.albedo = albedo;
+  return instance;
+}
+
+std::vector<NamedWorld> TestWorlds()
+{
+  XMVECTOR tiltedAxis = XMVectorSet(0.3f, 1.f, -0.6f, 0.f);
+  XMMATRIX translation = XMMatrixTranslation(12.5f, -3.f, 40.f);
+  XMMATRIX rotation = XMMatrixRotationAxis(tiltedAxis, 1.1f);
+  XMMATRIX mirrorX = XMMatrixScaling(-1.f, 1.f, 1.f);
+  XMMATRIX shear = XMMatrixIdentity();
+  shear.r[1] = XMVectorSet(0.4f, 1.f, 0.f, 0.f);
+  return {
+    {"identity", XMMatrixIdentity(), true},
+    {"rotated", rotation * translation, true},
+    {"rotated by pi", XMMatrixRotationAxis(tiltedAxis, XM_PI) * translation, true},
+    {"rotated and scaled", XMMatrixScaling(2.5f, 2.5f, 2.5f) * rotation * translation, true},
+    {"mirrored", mirrorX * rotation * translation, true},
+    {"point mirrored and scaled", XMMatrixScaling(-0.5f, -0.5f, -0.5f) * translation, true},
+    {"non-uniform scale", XMMatrixScaling(1.f, 3.f, 0.5f) * rotation * translation, false},
+    {"sheared", shear * rotation * translation, false}
+  };
+}
+
+void CheckUnpacked(
+  const std::string& name,
+  const InstanceData& original,
+  const InstanceData& unpacked,
+  float worldTolerance
+)
+{
+  float worldError = MaxAbsDifference(original.world, unpacked.world);
+  Expect(
+    worldError <= worldTolerance,
+    name + ": world off by " + std::to_string(worldError) + ", tolerance " +
+      std::to_string(worldTolerance)
+  );
+
+  XMFLOAT4X4 product;
+  XMFLOAT4X4 identity;
+  XMStoreFloat4x4(
+    &product, XMLoadFloat4x4(&unpacked.world) * XMLoadFloat4x4(&unpacked.invWorld)
+  );
+  XMStoreFloat4x4(&identity, XMMatrixIdentity());
+  float inverseError = MaxAbsDifference(product, identity);
+  Expect(
+    inverseError <= kInverseTolerance,
+    name + ": world * invWorld off identity by " + std::to_string(inverseError)
+  );
+
+  float albedoError = MaxAbsDifference(original.albedo, unpacked.albedo);
+  Expect(
+    albedoError <= kAlbedoTolerance, name + ": albedo off by " + std::to_string(albedoError)
+  );
+}
+
+void TestAlbedo()
+{
+  Expect(PackAlbedoRGBA8({0.f, 0.f, 0.f, 0.f}) == 0u, "albedo: black");
+  Expect(PackAlbedoRGBA8({1.f, 1.f, 1.f, 1.f}) == 0xffffffffu, "albedo: white");
+  Expect(PackAlbedoRGBA8({1.f, 0.f, 0.f, 0.f}) == 0x000000ffu, "albedo: x in the lowest byte");
+  Expect(PackAlbedoRGBA8({0.f, 0.f, 0.f, 1.f}) == 0xff000000u, "albedo: w in the highest byte");
+  Expect(PackAlbedoRGBA8({-1.f, 2.f, 0.f, 0.f}) == 0x0000ff00u, "albedo: saturated");
+
+  for (int step = 0; step <= 1000; ++step) {
+    float c = step / 1000.f;
+    XMFLOAT4 albedo = {c, 1.f - c, 0.5f * c, 1.f};
+    float error = MaxAbsDifference(albedo, UnpackAlbedoRGBA8(PackAlbedoRGBA8(albedo)));
+    Expect(
+      error <= kAlbedoTolerance,
+      "albedo: " + std::to_string(c) + " off by " + std::to_string(error)
+    );
+  }
+}
+
+void TestRoundTrips()
+{
+  XMFLOAT4 albedo = {0.2f, 0.75f, 0.333f, 1.f};
+  for (const NamedWorld& test : TestWorlds()) {
+    InstanceData instance = MakeInstance(test.world, albedo);
+
+    InstanceDataAffine affine;
+    PackInstance(instance, affine);
+    CheckUnpacked("affine " + test.name, instance, UnpackInstance(affine), kAffineWorldTolerance);
+
+    if (!test.rigid) {
+      continue;
+    }
+    InstanceDataQuatPosScale quat;
+    PackInstance(instance, quat);
+    float tolerance = kQuatWorldTolerance * std::max(1.f, MaxAbsLinearEntry(instance.world));
+    CheckUnpacked("quat " + test.name, instance, UnpackInstance(quat), tolerance);
+  }
+}
+
+// PackInstances writes the same bytes as PackInstance, gathered through `indices`
+template<typename PackedType>
+void TestPackInstances(InstanceFormat format, const std::vector<InstanceData>& instances)
+{
+  std::vector<size_t> indices(instances.size());
+  for (size_t k = 0; k < indices.size(); ++k) {
+    indices[k] = indices.size() - 1 - k;
+  }
+  std::vector<PackedType> packed(instances.size());
+  PackInstances(format, instances.data(), indices.data(), indices.size(), packed.data());
+
+  size_t mismatchCount = 0;
+  for (size_t k = 0; k < indices.size(); ++k) {
+    PackedType expected;
+    PackInstance(instances[indices[k]], expected);
+    mismatchCount += std::memcmp(&expected, &packed[k], sizeof(PackedType)) != 0;
+  }
+  Expect(
+    mismatchCount == 0, std::string{"PackInstances "} + InstanceFormatName(format) + ": " +
+                          std::to_string(mismatchCount) + " mismatches"
+  );
+}
+
+void TestPackInstances()
+{
+  // Above the packing grain, so ranges run on several tasks when the pool has workers
+  std::vector<InstanceData> instances;
+  for (size_t i = 0; i < 10'000; ++i) {
+    float t = static_cast<float>(i);
+    XMMATRIX world = XMMatrixRotationAxis(XMVectorSet(std::sin(t), 1.f, std::cos(t), 0.f), t) *
+                     XMMatrixTranslation(t, 0.f, -t);
+    instances.push_back(MakeInstance(world, {std::fmod(t * 0.01f, 1.f), 0.5f, 0.25f, 1.f}));
+  }
+  TestPackInstances<InstanceDataAffine>(InstanceFormat::Affine, instances);
+  TestPackInstances<InstanceDataQuatPosScale>(InstanceFormat::QuatPosScale, instances);
+}
+
+}  // namespace
+
+int main()
+{
+  dxh::JobSystem::Shared().AttachCallingThread();
+
+  TestAlbedo();
+  TestRoundTrips();
+  TestPackInstances();
+
+  if (g_failureCount > 0) {
+    std::cerr << g_failureCount << " checks failed\n";
+    return 1;
+  }
+  std::cout << "All instance format checks passed\n";
+  return 0;
+}
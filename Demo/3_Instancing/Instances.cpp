@@ -1,10 +1,21 @@
 #include "Instances.h"
 
 #include <iomanip>
+#include <mutex>
 
 #include "AutoTimer.h"
+#include "Bvh.h"
 #include "Culling.h"
+#include "JobSystem.h"
+#include "LinearOctree.h"
+#include "Lod.h"
+#include "MeshFactory.h"
+#include "OcclusionCulling.h"
 #include "Octree.h"
+#include "PacketCulling.h"
+#include "ParallelCulling.h"
+#include "SceneSnapshot.h"
+#include "UniformGrid.h"
 
 
 #define LOG_OCTREE
@@ -31,7 +42,7 @@ float g_yOffsetAmplitude = 3.f;
 
 int GridRowCount()
 {
-  return static_cast<int>(std::ceill(std::sqrt(g_instanceCount)));
+  return static_cast<int>(std::ceil(std::sqrt(g_instanceCount)));
 }
 
 int GridColCount()
@@ -79,8 +90,8 @@ XMFLOAT3 InstanceBasePosition(size_t index)
 float InstanceYOffset(size_t index, float time)
 {
   auto [r, c] = GridCoord(index);
-  return g_yOffsetAmplitude * std::sinf(g_waveFreq * (static_cast<float>(r) + time)) *
-         std::cosf(g_waveFreq * (static_cast<float>(c) + time));
+  return g_yOffsetAmplitude * std::sin(g_waveFreq * (static_cast<float>(r) + time)) *
+         std::cos(g_waveFreq * (static_cast<float>(c) + time));
 }
 
 XMFLOAT3 RotationAxis(CoordF coordSNorm)
@@ -148,13 +159,47 @@ std::vector<InstanceData> InitInstanceData(float time = 0.f)
   return instances;
 }
 
-std::vector<InstanceData> g_instanceBuffer = InitInstanceData();
-std::vector<InstanceSceneInfo> g_instanceSceneInfo(g_instanceCount);
+// Per-instance arrays stay empty until ResetInstances or LoadSceneSnapshot
+std::vector<InstanceData> g_instanceBuffer;
+std::vector<InstanceSceneInfo> g_instanceSceneInfo;
+AABBSoA g_instanceBoundsSoA;
 
-std::unique_ptr<OctreeNode<InstanceSceneInfo>> g_sceneOctree;
+Octree<InstanceSceneInfo> g_sceneOctree;
+
+// Bumped whenever instance bounds move, each acceleration structure remembers the version it was
+// last built or refitted for
+uint64_t g_instanceBoundsVersion = 1;
+
+LinearOctree g_linearOctree;
+uint64_t g_linearOctreeVersion = 0;
+
+Bvh g_bvh;
+uint64_t g_bvhVersion = 0;
+
+UniformGrid g_uniformGrid;
+uint64_t g_uniformGridVersion = 0;
+
+// Cell side of 8 x 8 instances of the field
+float GridCellSize()
+{
+  return 8.f * 2.5f;
+}
+
+AABB SceneBox()
+{
+  float fieldSize = FieldSize();
+  float halfSize = fieldSize * 0.5f + 5.f;  // add some margin
+  float sceneHeight = 16.f * g_yOffsetAmplitude + 5.f;
+  return {{-halfSize, -sceneHeight, -halfSize}, {halfSize, sceneHeight, halfSize}};
+}
+
+// Instances whose bounds left their octree node since the last dynamic update
+std::vector<InstanceSceneInfo*> g_octreeDirtyList;
 
 void RebuildSceneOctree()
 {
+  ClearOctreeDirtyList(g_octreeDirtyList);
+
   // Clear existing octree node pointers
 
   for (size_t i = 0; i < g_instanceCount; ++i) {
@@ -162,39 +207,233 @@ void RebuildSceneOctree()
     g_instanceSceneInfo[i].indexInNode = 0;
   }
 
-  float fieldSize = FieldSize();
-  float halfSize = fieldSize * 0.5f + 5.f;  // add some margin
-  float sceneHeight = 16.f * g_yOffsetAmplitude + 5.f;
-  AABB sceneBox = {{-halfSize, -sceneHeight, -halfSize}, {halfSize, sceneHeight, halfSize}};
-  g_sceneOctree = BuildSceneOctreeFromAABB(sceneBox, g_instanceSceneInfo);
+  BulkBuildSceneOctreeFromAABB(g_sceneOctree, SceneBox(), g_instanceSceneInfo);
 }
 
-void UpdateInstances(float time)
+// Animation terms shared by whole grid columns or rows, evaluated once per UpdateInstances call
+struct InstanceUpdateTables {
+  std::vector<float> columnX;
+  std::vector<float> columnSNorm;
+  std::vector<float> columnWave;  // cos(freq * (c + time))
+  std::vector<float> rowZ;
+  std::vector<float> rowSNorm;
+  std::vector<float> rowWave;  // amplitude * sin(freq * (r + time))
+};
+
+InstanceUpdateTables g_instanceUpdateTables;
+
+void BuildInstanceUpdateTables(float time, InstanceUpdateTables& tables)
 {
-  for (size_t i = 0; i < g_instanceCount; ++i) {
-    const XMFLOAT4X4& world = InstanceWorldMatrix(i, time);
-    g_instanceBuffer[i].world = world;
+  int colCount = GridColCount();
+  int rowCount = static_cast<int>((g_instanceCount - 1) / GridSize()) + 1;
+  float halfFieldSize = FieldSize() * 0.5f;
+
+  tables.columnX.resize(colCount);
+  tables.columnSNorm.resize(colCount);
+  tables.columnWave.resize(colCount);
+  for (int c = 0; c < colCount; ++c) {
+    float u = GridCoordSNorm({0, c}).first;
+    tables.columnSNorm[c] = u;
+    tables.columnX[c] = u * halfFieldSize;
+    tables.columnWave[c] = std::cos(g_waveFreq * (static_cast<float>(c) + time));
+  }
+
+  tables.rowZ.resize(rowCount);
+  tables.rowSNorm.resize(rowCount);
+  tables.rowWave.resize(rowCount);
+  for (int r = 0; r < rowCount; ++r) {
+    float v = GridCoordSNorm({r, 0}).second;
+    tables.rowSNorm[r] = v;
+    tables.rowZ[r] = v * halfFieldSize;
+    tables.rowWave[r] = g_yOffsetAmplitude * std::sin(g_waveFreq * (static_cast<float>(r) + time));
+  }
+}
 
-    const XMMATRIX& xmInvWorld = XMMatrixInverse(nullptr, XMLoadFloat4x4(&world));
-    XMStoreFloat4x4(&g_instanceBuffer[i].invWorld, xmInvWorld);
+// Instances that left their uniform grid cell since the last grid update, each queued once
+std::vector<uint32_t> g_gridDirtyList;
+std::vector<uint8_t> g_gridDirty;
 
-    g_instanceSceneInfo[i].worldPosition = InstanceWorldPosition(i, time);
-    XMMATRIX xmWorld = XMLoadFloat4x4(&world);
-    const auto& localAABB = AABB{{-0.5f, -0.5f, -0.5f}, {0.5f, 0.5f, 0.5f}};
-    g_instanceSceneInfo[i].worldAABB = TransformAABB(xmWorld, localAABB);
-    g_instanceSceneInfo[i].instanceIndex = i;
+void ClearGridDirtyList()
+{
+  for (uint32_t index : g_gridDirtyList) {
+    g_gridDirty[index] = 0;
   }
+  g_gridDirtyList.clear();
 }
 
-std::vector<size_t> g_initInstanceIndices = []() {
-  std::vector<size_t> indices(g_instanceCount);
-  for (size_t i = 0; i < g_instanceCount; ++i) {
-    indices[i] = i;
+// Per-worker dirty lists of UpdateInstances, appended to g_octreeDirtyList and g_gridDirtyList
+// after the update
+struct UpdateDirtyLists {
+  std::vector<InstanceSceneInfo*> octree;
+  std::vector<uint32_t> grid;
+  float gridHalfExtent = 0.f;  // Largest half extent for the grid margin
+};
+
+std::vector<UpdateDirtyLists> g_updateDirtyLists;
+
+// Matches InstanceWorldMatrix, InstanceWorldPosition and the generic bound transforms up to
+// rounding, built from the column and row tables. The world matrix is a rotation R followed by a
+// translation t, so its inverse is R^T followed by -t R^T and needs no general inversion
+void UpdateInstanceRange(
+  size_t first,
+  size_t last,
+  float sinAngle,
+  float cosAngle,
+  UpdateDirtyLists& dirtyLists
+)
+{
+  const bool trackGrid = !g_uniformGrid.Empty();
+  const InstanceUpdateTables& tables = g_instanceUpdateTables;
+  const size_t gridSize = static_cast<size_t>(GridSize());
+  const float oneMinusCos = 1.f - cosAngle;
+  const float invSqrt2 = 1.f / std::sqrt(2.f);
+  const float sphereRadius = 0.5f * std::sqrt(3.f);
+
+  for (size_t i = first; i < last; ++i) {
+    size_t row = i / gridSize;
+    size_t col = i % gridSize;
+    float u = tables.columnSNorm[col];
+    float v = tables.rowSNorm[row];
+    float y = tables.rowWave[row] * tables.columnWave[col];
+    XMFLOAT3 pos = {tables.columnX[col], y, tables.rowZ[row]};
+
+    // RotationAxis is (v, d, -u) with d = sqrt(u^2 + v^2), its length is sqrt(2) d
+    float dist = std::sqrt(u * u + v * v);
+    float invLength = invSqrt2 / dist;
+    float ax = v * invLength;
+    float ay = dist * invLength;
+    float az = -u * invLength;
+
+    // Rows of the rotation matrix, same layout as XMMatrixRotationNormal
+    float r[3][3] = {
+      {oneMinusCos * ax * ax + cosAngle, oneMinusCos * ax * ay + sinAngle * az,
+       oneMinusCos * ax * az - sinAngle * ay},
+      {oneMinusCos * ax * ay - sinAngle * az, oneMinusCos * ay * ay + cosAngle,
+       oneMinusCos * ay * az + sinAngle * ax},
+      {oneMinusCos * ax * az + sinAngle * ay, oneMinusCos * ay * az - sinAngle * ax,
+       oneMinusCos * az * az + cosAngle}
+    };
+
+    InstanceData& instance = g_instanceBuffer[i];
+    for (int k = 0; k < 3; ++k) {
+      instance.world.m[k][0] = r[k][0];
+      instance.world.m[k][1] = r[k][1];
+      instance.world.m[k][2] = r[k][2];
+      instance.world.m[k][3] = 0.f;
+      instance.invWorld.m[k][0] = r[0][k];
+      instance.invWorld.m[k][1] = r[1][k];
+      instance.invWorld.m[k][2] = r[2][k];
+      instance.invWorld.m[k][3] = 0.f;
+      instance.invWorld.m[3][k] = -(pos.x * r[k][0] + pos.y * r[k][1] + pos.z * r[k][2]);
+    }
+    instance.world.m[3][0] = pos.x;
+    instance.world.m[3][1] = pos.y;
+    instance.world.m[3][2] = pos.z;
+    instance.world.m[3][3] = 1.f;
+    instance.invWorld.m[3][3] = 1.f;
+
+    // Bounds of the unit box, the AABB extent is the sum of the absolute half axes (Arvo)
+    InstanceSceneInfo& info = g_instanceSceneInfo[i];
+    info.worldPosition = pos;
+    XMFLOAT3 extent = {0.f, 0.f, 0.f};
+    for (int k = 0; k < 3; ++k) {
+      info.worldOBB.halfAxes[k] = {0.5f * r[k][0], 0.5f * r[k][1], 0.5f * r[k][2]};
+      extent.x += std::fabs(info.worldOBB.halfAxes[k].x);
+      extent.y += std::fabs(info.worldOBB.halfAxes[k].y);
+      extent.z += std::fabs(info.worldOBB.halfAxes[k].z);
+    }
+    info.worldOBB.center = pos;
+    info.worldSphere = {pos, sphereRadius};
+    info.worldAABB = {
+      {pos.x - extent.x, pos.y - extent.y, pos.z - extent.z},
+      {pos.x + extent.x, pos.y + extent.y, pos.z + extent.z}
+    };
+    info.instanceIndex = i;
+    g_instanceBoundsSoA.Set(i, info.worldAABB);
+    TrackOctreeObject(dirtyLists.octree, info);
+    if (trackGrid) {
+      dirtyLists.gridHalfExtent =
+        std::max(dirtyLists.gridHalfExtent, UniformGrid::HalfExtent(info.worldAABB));
+      if (!g_gridDirty[i] && g_uniformGrid.NeedsUpdate(static_cast<uint32_t>(i), info.worldAABB)) {
+        g_gridDirty[i] = 1;
+        dirtyLists.grid.push_back(static_cast<uint32_t>(i));
+      }
+    }
   }
-  return indices;
-}();
+}
+
+void UpdateInstances(float time)
+{
+  BuildInstanceUpdateTables(time, g_instanceUpdateTables);
+  float rad = XMConvertToRadians(std::fmod(time * g_rotSpeed, 360.f));
+  float sinAngle = std::sin(rad);
+  float cosAngle = std::cos(rad);
+
+  // Blocks touch disjoint instances, only the dirty list needs one copy per block
+  size_t blockCount = CullBlockCount(g_instanceCount, g_cullThreadCount);
+  if (g_updateDirtyLists.size() < blockCount) {
+    g_updateDirtyLists.resize(blockCount);
+  }
+  ParallelForBlocks(
+    g_instanceCount, g_cullThreadCount, [&](size_t block, size_t first, size_t last) {
+      UpdateDirtyLists& dirtyLists = g_updateDirtyLists[block];
+      dirtyLists.octree.clear();
+      dirtyLists.grid.clear();
+      dirtyLists.gridHalfExtent = 0.f;
+      UpdateInstanceRange(first, last, sinAngle, cosAngle, dirtyLists);
+    }
+  );
+  for (size_t block = 0; block < blockCount; ++block) {
+    const UpdateDirtyLists& dirtyLists = g_updateDirtyLists[block];
+    g_octreeDirtyList.insert(
+      g_octreeDirtyList.end(), dirtyLists.octree.begin(), dirtyLists.octree.end()
+    );
+    g_gridDirtyList.insert(g_gridDirtyList.end(), dirtyLists.grid.begin(), dirtyLists.grid.end());
+    if (!g_uniformGrid.Empty()) {
+      g_uniformGrid.GrowMargin(dirtyLists.gridHalfExtent);
+    }
+  }
+  ++g_instanceBoundsVersion;
+}
+
+std::vector<size_t> g_initInstanceIndices;
 
 std::vector<size_t> g_culledInstanceIndices;
+size_t g_cullCounter = 0;
+
+void StoreCulledInstanceIndices(uint32_t* dst)
+{
+  for (size_t k = 0; k < g_culledInstanceIndices.size(); ++k) {
+    dst[k] = static_cast<uint32_t>(g_culledInstanceIndices[k]);
+  }
+}
+
+// Instances accepted by a hierarchy without per-object tests, they lead g_culledInstanceIndices
+// and are carried over by the per-object passes
+size_t g_acceptedInstanceCount = 0;
+
+std::vector<size_t> AcceptedInstances()
+{
+  auto first = g_culledInstanceIndices.begin();
+  return std::vector<size_t>(first, first + g_acceptedInstanceCount);
+}
+
+bool g_usePlaneCoherency = true;
+PlaneCoherencyStats g_planeCoherencyStats;
+
+// Frustum plane that rejected each instance last time it was tested, plane i is the same plane in
+// world and local space so both passes share it
+std::vector<uint8_t> g_lastRejectingPlane;
+
+// Cache slot of an instance, or `scratch` reset to no plane when the cache is disabled
+uint8_t& RejectingPlaneSlot(size_t index, uint8_t& scratch)
+{
+  scratch = kNoRejectingPlane;
+  return g_usePlaneCoherency ? g_lastRejectingPlane[index] : scratch;
+}
+
+bool g_useTightBounds = true;
+TightBoundsStats g_tightBoundsStats;
 
 Frustum CameraFrustumNDC()
 {
@@ -228,9 +467,90 @@ Frustum WorldSpaceFrustum(const dxh::PerspectiveCamera& cam)
   return worldFrustum;
 }
 
+// Same planes as WorldSpaceFrustum with unit normals, as sphere tests need distances
+Frustum NormalizedWorldSpaceFrustum(const dxh::PerspectiveCamera& cam)
+{
+  Frustum frustum = WorldSpaceFrustum(cam);
+  for (auto& plane : frustum.planes) {
+    plane = NormalizePlane(plane);
+  }
+  return frustum;
+}
+
+// Sphere then OBB test against a frustum with unit plane normals
+bool IsInstanceVisibleTightBounds(
+  size_t index,
+  const Frustum& worldFrustum,
+  uint8_t& rejectingPlane,
+  PlaneCoherencyStats& planeStats,
+  TightBoundsStats& stats
+)
+{
+  const InstanceSceneInfo& info = g_instanceSceneInfo[index];
+  auto passesPlane = [&](uint8_t plane) {
+    return IntersectTightBoundsPlane(
+      info.worldSphere, info.worldOBB, worldFrustum.planes[plane], stats
+    );
+  };
+  if (TestPlanesCoherent(rejectingPlane, passesPlane, planeStats)) {
+    return true;
+  }
+  // Most rejected AABBs fail the same plane, the full test only runs when they pass it
+  const AABB& box = info.worldAABB;
+  if (IntersectAABBPlane(box, worldFrustum.planes[rejectingPlane]) && box.Intersect(worldFrustum)) {
+    ++stats.aabbFalsePositives;
+  }
+  return false;
+}
+
+// Packet kernels only test AABBs, so tight bounds refine the survivors from `first` on. Everything
+// removed here passed its AABB
+void RefineWithTightBounds(
+  const Frustum& worldFrustum,
+  std::vector<size_t>& survivors,
+  size_t first,
+  TightBoundsStats& stats
+)
+{
+  auto isHidden = [&](size_t i) {
+    const InstanceSceneInfo& info = g_instanceSceneInfo[i];
+    for (const Plane& plane : worldFrustum.planes) {
+      if (!IntersectTightBoundsPlane(info.worldSphere, info.worldOBB, plane, stats)) {
+        ++stats.aabbFalsePositives;
+        return true;
+      }
+    }
+    return false;
+  };
+  auto hidden = std::remove_if(survivors.begin() + first, survivors.end(), isHidden);
+  survivors.erase(hidden, survivors.end());
+}
+
+bool IsInstanceVisibleLocalSpace(
+  const InstanceData& instance,
+  const XMMATRIX& xmView,
+  const XMMATRIX& xmProj,
+  const Frustum& frustumNDC,
+  const AABB& instanceAABB,
+  uint8_t& rejectingPlane,
+  PlaneCoherencyStats& stats
+)
+{
+  XMMATRIX xmWorld = XMLoadFloat4x4(&instance.world);
+
+  XMMATRIX xmMVP = xmWorld * xmView * xmProj;
+  XMMATRIX xmInvMVP = XMMatrixInverse(nullptr, xmMVP);
+
+  auto passesPlane = [&](uint8_t i) {
+    Plane localPlane = TransformPlane(xmInvMVP, frustumNDC.planes[i]);
+    return IntersectAABBPlane(instanceAABB, localPlane);
+  };
+  return TestPlanesCoherent(rejectingPlane, passesPlane, stats);
+}
+
 void CullInstancesLocalSpace(const dxh::PerspectiveCamera& cam)
 {
-  std::vector<size_t> culledIndices;
+  std::vector<size_t> culledIndices = AcceptedInstances();
 
   Frustum frustum = CameraFrustumNDC();
   AABB instanceAABB = {{-0.5f, -0.5f, -0.5f}, {0.5f, 0.5f, 0.5f}};
@@ -241,23 +561,44 @@ void CullInstancesLocalSpace(const dxh::PerspectiveCamera& cam)
   XMFLOAT4X4 projMatrix = cam.ProjectionMatrix();
   XMMATRIX xmProj = XMLoadFloat4x4(&projMatrix);
 
-  for (size_t i : g_culledInstanceIndices) {
+  uint8_t scratch;
+  for (size_t k = g_acceptedInstanceCount; k < g_culledInstanceIndices.size(); ++k) {
+    size_t i = g_culledInstanceIndices[k];
     const InstanceData& instance = g_instanceBuffer[i];
-    XMMATRIX xmWorld = XMLoadFloat4x4(&instance.world);
+    uint8_t& rejectingPlane = RejectingPlaneSlot(i, scratch);
+    if (IsInstanceVisibleLocalSpace(
+          instance, xmView, xmProj, frustum, instanceAABB, rejectingPlane, g_planeCoherencyStats
+        )) {
+      culledIndices.push_back(i);
+    }
+  }
 
-    XMMATRIX xmMVP = xmWorld * xmView * xmProj;
-    XMMATRIX xmInvMVP = XMMatrixInverse(nullptr, xmMVP);
+  g_culledInstanceIndices = culledIndices;
+}
 
-    bool culled = false;
-    for (auto plane : frustum.planes) {
-      Plane localPlane = TransformPlane(xmInvMVP, plane);
-      if (!IntersectAABBPlane(instanceAABB, localPlane)) {
-        culled = true;
-        break;
+void CullInstancesWorldSpace(const dxh::PerspectiveCamera& cam)
+{
+  std::vector<size_t> culledIndices = AcceptedInstances();
+  Frustum worldFrustum = NormalizedWorldSpaceFrustum(cam);
+
+  uint8_t scratch;
+  for (size_t k = g_acceptedInstanceCount; k < g_culledInstanceIndices.size(); ++k) {
+    size_t i = g_culledInstanceIndices[k];
+    uint8_t& rejectingPlane = RejectingPlaneSlot(i, scratch);
+    if (g_useTightBounds) {
+      if (IsInstanceVisibleTightBounds(
+            i, worldFrustum, rejectingPlane, g_planeCoherencyStats, g_tightBoundsStats
+          )) {
+        culledIndices.push_back(i);
       }
+      continue;
     }
 
-    if (!culled) {
+    const AABB& worldAABB = g_instanceSceneInfo[i].worldAABB;
+    auto passesPlane = [&](uint8_t plane) {
+      return IntersectAABBPlane(worldAABB, worldFrustum.planes[plane]);
+    };
+    if (TestPlanesCoherent(rejectingPlane, passesPlane, g_planeCoherencyStats)) {
       culledIndices.push_back(i);
     }
   }
@@ -265,59 +606,522 @@ void CullInstancesLocalSpace(const dxh::PerspectiveCamera& cam)
   g_culledInstanceIndices = culledIndices;
 }
 
-void CullInstancesWorldSpace(const dxh::PerspectiveCamera& cam)
+void CullInstancesWorldSpacePacket(const dxh::PerspectiveCamera& cam, bool testAllInstances)
 {
-  std::vector<size_t> culledIndices;
-  Frustum worldFrustum = WorldSpaceFrustum(cam);
+  std::vector<size_t> culledIndices = AcceptedInstances();
+  culledIndices.reserve(g_culledInstanceIndices.size());
+  Frustum worldFrustum = NormalizedWorldSpaceFrustum(cam);
+
+  if (testAllInstances) {
+    CullAABBPacket(worldFrustum, g_instanceBoundsSoA, 0, g_instanceCount, culledIndices);
+  } else {
+    CullAABBPacketIndexed(
+      worldFrustum, g_instanceBoundsSoA, g_culledInstanceIndices.data() + g_acceptedInstanceCount,
+      g_culledInstanceIndices.size() - g_acceptedInstanceCount, culledIndices
+    );
+  }
+  if (g_useTightBounds) {
+    RefineWithTightBounds(worldFrustum, culledIndices, g_acceptedInstanceCount, g_tightBoundsStats);
+  }
 
-  for (size_t i : g_culledInstanceIndices) {
-    const AABB& worldAABB = g_instanceSceneInfo[i].worldAABB;
-    if (worldAABB.Intersect(worldFrustum)) {
-      culledIndices.push_back(i);
+  g_culledInstanceIndices = std::move(culledIndices);
+}
+
+size_t g_cullThreadCount = 0;
+ParallelCullBuffers g_parallelCullBuffers;
+
+void CullInstancesLocalSpaceParallel(const dxh::PerspectiveCamera& cam)
+{
+  Frustum frustum = CameraFrustumNDC();
+  AABB instanceAABB = {{-0.5f, -0.5f, -0.5f}, {0.5f, 0.5f, 0.5f}};
+
+  XMFLOAT4X4 viewMatrix = cam.ViewMatrix();
+  XMMATRIX xmView = XMLoadFloat4x4(&viewMatrix);
+
+  XMFLOAT4X4 projMatrix = cam.ProjectionMatrix();
+  XMMATRIX xmProj = XMLoadFloat4x4(&projMatrix);
+
+  const size_t* candidates = g_culledInstanceIndices.data() + g_acceptedInstanceCount;
+  size_t candidateCount = g_culledInstanceIndices.size() - g_acceptedInstanceCount;
+  std::vector<size_t> culledIndices = AcceptedInstances();
+  std::mutex statsMutex;
+
+  // Chunks cover disjoint instances, so each worker owns the cache slots it touches
+  ParallelCullChunks(
+    candidateCount, g_cullThreadCount, g_parallelCullBuffers, culledIndices,
+    [&](size_t first, size_t last, std::vector<size_t>& chunkOut) {
+      PlaneCoherencyStats chunkStats;
+      uint8_t scratch;
+      for (size_t k = first; k < last; ++k) {
+        size_t i = candidates[k];
+        const InstanceData& instance = g_instanceBuffer[i];
+        uint8_t& rejectingPlane = RejectingPlaneSlot(i, scratch);
+        if (IsInstanceVisibleLocalSpace(
+              instance, xmView, xmProj, frustum, instanceAABB, rejectingPlane, chunkStats
+            )) {
+          chunkOut.push_back(i);
+        }
+      }
+      std::lock_guard<std::mutex> lock{statsMutex};
+      g_planeCoherencyStats.Add(chunkStats);
+    }
+  );
+
+  g_culledInstanceIndices = std::move(culledIndices);
+}
+
+void CullInstancesWorldSpaceParallel(const dxh::PerspectiveCamera& cam, bool testAllInstances)
+{
+  Frustum worldFrustum = NormalizedWorldSpaceFrustum(cam);
+
+  const size_t* candidates = g_culledInstanceIndices.data() + g_acceptedInstanceCount;
+  size_t candidateCount = g_culledInstanceIndices.size() - g_acceptedInstanceCount;
+  std::vector<size_t> culledIndices = AcceptedInstances();
+  std::mutex statsMutex;
+
+  ParallelCullChunks(
+    testAllInstances ? g_instanceCount : candidateCount, g_cullThreadCount,
+    g_parallelCullBuffers, culledIndices,
+    [&](size_t first, size_t last, std::vector<size_t>& chunkOut) {
+      if (testAllInstances) {
+        CullAABBPacket(worldFrustum, g_instanceBoundsSoA, first, last - first, chunkOut);
+      } else {
+        CullAABBPacketIndexed(
+          worldFrustum, g_instanceBoundsSoA, candidates + first, last - first, chunkOut
+        );
+      }
+      if (!g_useTightBounds) {
+        return;
+      }
+      TightBoundsStats chunkStats;
+      RefineWithTightBounds(worldFrustum, chunkOut, 0, chunkStats);
+      std::lock_guard<std::mutex> lock{statsMutex};
+      g_tightBoundsStats.Add(chunkStats);
     }
+  );
+
+  g_culledInstanceIndices = std::move(culledIndices);
+}
+
+bool g_enableLodSelection = true;
+int g_lodScreenHeight = 600;
+// LOD 2 reaches down to 1 pixel, only sub-pixel instances are dropped
+std::vector<float> g_lodPixelSizes = {64.f, 24.f, 1.f};
+std::vector<LodRange> g_lodRanges;
+LodStats g_lodStats;
+
+// Bounding sphere radius of an instance, the half diagonal of the unit box
+float InstanceRadius()
+{
+  return 0.5f * std::sqrt(3.f);
+}
+
+// LOD given to whole octree subtrees, valid for the CullInstances call whose g_cullCounter it holds
+struct BulkLod {
+  size_t cullCounter = 0;
+  uint8_t lod = 0;
+};
+
+std::vector<BulkLod> g_bulkLods;
+
+void AddOctreeObject(const InstanceSceneInfo* obj, uint8_t lod, std::vector<size_t>& out)
+{
+  out.push_back(obj->instanceIndex);
+  if (lod < kMaxLodCount) {
+    g_bulkLods[obj->instanceIndex] = {g_cullCounter, lod};
+    ++g_lodStats.bulkAssignedCount;
   }
+}
 
-  g_culledInstanceIndices = culledIndices;
+// Every object of a subtree is contained in the loose box of each of its ancestors, so planes
+// fully containing a node can be skipped for its children and objects
+void CollectOctreeObjects(
+  const OctreeNode<InstanceSceneInfo>* node,
+  uint8_t lod,
+  std::vector<size_t>& out
+)
+{
+  for (const InstanceSceneInfo* obj : node->objects) {
+    AddOctreeObject(obj, lod, out);
+  }
+  if (!node->IsLeaf()) {
+    for (const auto* child : node->children) {
+      assert(child);
+      CollectOctreeObjects(child, lod, out);
+    }
+  }
 }
 
+// Nodes too small on screen are dropped with their subtree and nodes whose objects all share a
+// LOD assign it in bulk, `lod` is kLodMixed until an ancestor decided it
 void CullOctreeNodesImpl(
-  const dxh::PerspectiveCamera& cam,
   const OctreeNode<InstanceSceneInfo>* node,
   const Frustum& worldFrustum,
-  std::vector<size_t>& outCulledIndices
+  const LodSelector* lodSelector,
+  uint8_t planeMask,
+  uint8_t lod,
+  std::vector<size_t>& outAccepted,
+  std::vector<size_t>& outCandidates
 )
 {
-  if (!node->bbox.Intersect(worldFrustum)) {
+  CullResult result = ClassifyAABB(node->bbox, worldFrustum, planeMask);
+  if (result == CullResult::Outside) {
     return;
   }
 
-  if (node->IsLeaf()) {
-    for (const auto* obj : node->objects) {
-      outCulledIndices.push_back(obj->instanceIndex);
+  if (lodSelector && lod == kLodMixed) {
+    lod = lodSelector->SelectBoxLod(node->bbox, InstanceRadius(), InstanceRadius());
+    if (lod == kLodCulled) {
+      ++g_lodStats.culledNodeCount;
+      return;
     }
+  }
+
+  bool lodDecided = !lodSelector || lod != kLodMixed;
+  if (result == CullResult::Inside && lodDecided) {
+    CollectOctreeObjects(node, lod, outAccepted);
     return;
   }
 
+  std::vector<size_t>& out = result == CullResult::Inside ? outAccepted : outCandidates;
   for (const InstanceSceneInfo* obj : node->objects) {
-    outCulledIndices.push_back(obj->instanceIndex);
+    AddOctreeObject(obj, lod, out);
   }
 
-  for (const auto* child : node->children) {
-    assert(child);
-    CullOctreeNodesImpl(cam, child, worldFrustum, outCulledIndices);
+  if (!node->IsLeaf()) {
+    for (const auto* child : node->children) {
+      assert(child);
+      CullOctreeNodesImpl(
+        child, worldFrustum, lodSelector, planeMask, lod, outAccepted, outCandidates
+      );
+    }
   }
 }
 
+// Buffers of the hierarchical culls, kept between frames
+std::vector<size_t> g_hierarchyAccepted;
+std::vector<size_t> g_hierarchyCandidates;
+
+// Stores accepted instances followed by candidates that still need a per-object test
+template<typename HierarchyCullFunc>
+void CullHierarchy(HierarchyCullFunc cull)
+{
+  g_hierarchyAccepted.clear();
+  g_hierarchyCandidates.clear();
+  cull(g_hierarchyAccepted, g_hierarchyCandidates);
+
+  g_acceptedInstanceCount = g_hierarchyAccepted.size();
+  g_culledInstanceIndices.assign(g_hierarchyAccepted.begin(), g_hierarchyAccepted.end());
+  g_culledInstanceIndices.insert(
+    g_culledInstanceIndices.end(), g_hierarchyCandidates.begin(), g_hierarchyCandidates.end()
+  );
+}
+
 void CullOctreeNodes(const dxh::PerspectiveCamera& cam, const OctreeNode<InstanceSceneInfo>* node)
 {
-  std::vector<size_t> culledIndices;
-  culledIndices.reserve(g_instanceCount);
   Frustum worldFrustum = WorldSpaceFrustum(cam);
-  CullOctreeNodesImpl(cam, node, worldFrustum, culledIndices);
-  g_culledInstanceIndices = culledIndices;
+  LodSelector lodSelector{cam, g_lodScreenHeight, g_lodPixelSizes};
+  const LodSelector* nodeLodSelector = g_enableLodSelection ? &lodSelector : nullptr;
+  CullHierarchy([&](std::vector<size_t>& accepted, std::vector<size_t>& candidates) {
+    CullOctreeNodesImpl(
+      node, worldFrustum, nodeLodSelector, kAllFrustumPlanes, kLodMixed, accepted, candidates
+    );
+  });
+}
+
+void CullLinearOctree(const dxh::PerspectiveCamera& cam)
+{
+  Frustum worldFrustum = WorldSpaceFrustum(cam);
+  CullHierarchy([&](std::vector<size_t>& accepted, std::vector<size_t>& candidates) {
+    g_linearOctree.Cull(worldFrustum, accepted, candidates);
+  });
+}
+
+void CullUniformGrid(const dxh::PerspectiveCamera& cam)
+{
+  Frustum worldFrustum = WorldSpaceFrustum(cam);
+  CullHierarchy([&](std::vector<size_t>& accepted, std::vector<size_t>& candidates) {
+    g_uniformGrid.Cull(worldFrustum, accepted, candidates);
+  });
+}
+
+void CullBvh(const dxh::PerspectiveCamera& cam)
+{
+  Frustum worldFrustum = WorldSpaceFrustum(cam);
+  CullHierarchy([&](std::vector<size_t>& accepted, std::vector<size_t>& candidates) {
+    g_bvh.Cull(worldFrustum, accepted, candidates);
+  });
+}
+
+bool g_enableOcclusionCulling = true;
+size_t g_occluderCount = 4096;
+int g_occlusionBufferWidth = 320;
+
+OcclusionBuffer g_occlusionBuffer;
+OcclusionStats g_occlusionStats;
+
+// Only positions of the rendered box mesh are needed to rasterize it as an occluder
+struct OccluderVertex {
+  XMFLOAT3 position;
+  XMFLOAT3 normal;
+  std::array<uint8_t, 4> color;
+};
+
+struct OccluderMesh {
+  std::vector<XMFLOAT3> positions;
+  std::vector<uint16_t> indices;
+};
+
+const OccluderMesh& UnitBoxOccluder()
+{
+  static const OccluderMesh mesh = []() {
+    auto meshData = dxh::CreateUnitBoxWithNormal<OccluderVertex, uint16_t>();
+    OccluderMesh m;
+    for (const auto& vertex : meshData.vertices) {
+      m.positions.push_back(vertex.position);
+    }
+    m.indices = meshData.indices;
+    return m;
+  }();
+  return mesh;
+}
+
+struct OccluderCandidate {
+  float distanceSq;
+  size_t index;
+};
+
+// Scratch of CullInstancesOcclusion kept between frames
+std::vector<OccluderCandidate> g_occluderCandidates;
+std::vector<XMMATRIX> g_occluderTransforms;
+
+// Rasterizes the instances nearest to the camera among the frustum survivors, then drops every
+// survivor whose bounds are hidden behind them
+void CullInstancesOcclusion(const dxh::PerspectiveCamera& cam)
+{
+  XMFLOAT4X4 viewMatrix = cam.ViewMatrix();
+  XMFLOAT4X4 projMatrix = cam.ProjectionMatrix();
+  XMMATRIX xmViewProj = XMLoadFloat4x4(&viewMatrix) * XMLoadFloat4x4(&projMatrix);
+
+  int height = std::max(1, static_cast<int>(g_occlusionBufferWidth / cam.aspectRatio));
+  if (g_occlusionBuffer.Width() != g_occlusionBufferWidth ||
+      g_occlusionBuffer.Height() != height) {
+    g_occlusionBuffer.Resize(g_occlusionBufferWidth, height);
+  } else {
+    g_occlusionBuffer.Clear();
+  }
+
+  // Camera distances are computed once, not on every comparison of the selection
+  std::vector<size_t>& visible = g_culledInstanceIndices;
+  g_occluderCandidates.resize(visible.size());
+  XMVECTOR xmEye = XMLoadFloat3(&cam.position);
+  for (size_t k = 0; k < visible.size(); ++k) {
+    XMVECTOR xmPos = XMLoadFloat3(&g_instanceSceneInfo[visible[k]].worldPosition);
+    float distanceSq = XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(xmPos, xmEye)));
+    g_occluderCandidates[k] = {distanceSq, visible[k]};
+  }
+  size_t occluderCount = std::min(g_occluderCount, g_occluderCandidates.size());
+  std::nth_element(
+    g_occluderCandidates.begin(), g_occluderCandidates.begin() + occluderCount,
+    g_occluderCandidates.end(),
+    [](const OccluderCandidate& a, const OccluderCandidate& b) {
+      return a.distanceSq < b.distanceSq;
+    }
+  );
+
+  g_occluderTransforms.resize(occluderCount);
+  for (size_t k = 0; k < occluderCount; ++k) {
+    XMMATRIX xmWorld = XMLoadFloat4x4(&g_instanceBuffer[g_occluderCandidates[k].index].world);
+    g_occluderTransforms[k] = xmWorld * xmViewProj;
+  }
+  const OccluderMesh& mesh = UnitBoxOccluder();
+  g_occlusionBuffer.RasterizeOccluders(
+    g_occluderTransforms.data(), occluderCount, mesh.positions.data(), mesh.positions.size(),
+    mesh.indices.data(), mesh.indices.size()
+  );
+
+  std::vector<size_t> culledIndices;
+  ParallelCullChunks(
+    visible.size(), g_cullThreadCount, g_parallelCullBuffers, culledIndices,
+    [&](size_t first, size_t last, std::vector<size_t>& chunkOut) {
+      for (size_t k = first; k < last; ++k) {
+        size_t i = visible[k];
+        if (g_occlusionBuffer.TestAABB(g_instanceSceneInfo[i].worldAABB, xmViewProj)) {
+          chunkOut.push_back(i);
+        }
+      }
+    }
+  );
+
+  g_occlusionStats.occluderCount = occluderCount;
+  g_occlusionStats.testedCount = visible.size();
+  g_occlusionStats.occludedCount = visible.size() - culledIndices.size();
+  g_culledInstanceIndices = std::move(culledIndices);
+}
+
+std::vector<uint8_t> g_survivorLods;
+std::vector<size_t> g_lodSortedIndices;
+
+// Orders g_culledInstanceIndices by LOD with a counting sort. Instances keep the LOD their octree
+// node assigned this call, the others are measured one by one and dropped when too small
+void BucketInstancesByLod(const dxh::PerspectiveCamera& cam)
+{
+  LodSelector lodSelector{cam, g_lodScreenHeight, g_lodPixelSizes};
+  size_t lodCount = lodSelector.LodCount();
+  std::vector<size_t> counts(lodCount, 0);
+
+  const std::vector<size_t>& visible = g_culledInstanceIndices;
+  g_survivorLods.resize(visible.size());
+  for (size_t k = 0; k < visible.size(); ++k) {
+    size_t i = visible[k];
+    const BulkLod& bulk = g_bulkLods[i];
+    uint8_t lod = bulk.cullCounter == g_cullCounter
+                    ? bulk.lod
+                    : lodSelector.SelectLod(g_instanceSceneInfo[i].worldPosition, InstanceRadius());
+    g_survivorLods[k] = lod;
+    if (lod == kLodCulled) {
+      ++g_lodStats.droppedCount;
+    } else {
+      ++counts[lod];
+    }
+  }
+
+  // Counts become the write cursor of each range
+  g_lodRanges.resize(lodCount);
+  size_t offset = 0;
+  for (size_t lod = 0; lod < lodCount; ++lod) {
+    g_lodRanges[lod] = {offset, counts[lod]};
+    counts[lod] = offset;
+    offset += g_lodRanges[lod].count;
+  }
+
+  g_lodSortedIndices.resize(offset);
+  for (size_t k = 0; k < visible.size(); ++k) {
+    uint8_t lod = g_survivorLods[k];
+    if (lod != kLodCulled) {
+      g_lodSortedIndices[counts[lod]++] = visible[k];
+    }
+  }
+  std::swap(g_culledInstanceIndices, g_lodSortedIndices);
 }
 
 bool g_octreeBuilt = false;
+CullTimings g_cullTimings;
+
+// Sizes every per-instance array for `instanceCount` instances and drops every acceleration
+// structure
+void ResizeInstanceState(size_t instanceCount)
+{
+  // Scene info is reallocated, drop every pointer into it first
+  g_octreeDirtyList.clear();
+  g_gridDirtyList.clear();
+  g_gridDirty.assign(instanceCount, 0);
+  g_octreeBuilt = false;
+
+  g_instanceCount = instanceCount;
+  g_instanceSceneInfo.assign(instanceCount, {});
+  g_instanceBoundsSoA.Resize(instanceCount);
+  g_initInstanceIndices.resize(instanceCount);
+  std::iota(g_initInstanceIndices.begin(), g_initInstanceIndices.end(), size_t{0});
+  g_lastRejectingPlane.assign(instanceCount, kNoRejectingPlane);
+  g_bulkLods.assign(instanceCount, {});
+
+  g_linearOctree = {};
+  g_bvh = {};
+  g_uniformGrid = {};
+  ++g_instanceBoundsVersion;
+}
+
+void ResetInstances(size_t instanceCount)
+{
+  ResizeInstanceState(instanceCount);
+  g_instanceBuffer = InitInstanceData();
+}
+
+// Bumped whenever GetInstance or the field layout changes the scene it generates
+constexpr uint64_t kSceneGeneratorVersion = 1;
+
+// FNV-1a over the generator version and the animation parameters, snapshots written with another
+// key hold a different scene and are regenerated
+uint64_t SceneGeneratorKey()
+{
+  uint64_t hash = 14695981039346656037ull;
+  auto add = [&hash](const auto& value) {
+    const auto* bytes = reinterpret_cast<const uint8_t*>(&value);
+    for (size_t i = 0; i < sizeof(value); ++i) {
+      hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+  };
+  add(kSceneGeneratorVersion);
+  add(g_waveFreq);
+  add(g_rotSpeed);
+  add(g_yOffsetAmplitude);
+  return hash;
+}
+
+bool SaveSceneSnapshot(const std::string& path)
+{
+  if (g_linearOctreeVersion != g_instanceBoundsVersion || g_linearOctree.Empty()) {
+    g_linearOctree.Build(g_instanceBoundsSoA);
+    g_linearOctreeVersion = g_instanceBoundsVersion;
+  }
+
+  std::vector<InstanceBounds> bounds(g_instanceCount);
+  for (size_t i = 0; i < g_instanceCount; ++i) {
+    const InstanceSceneInfo& info = g_instanceSceneInfo[i];
+    bounds[i] = {info.worldPosition, info.worldAABB, info.worldSphere, info.worldOBB};
+  }
+
+  SceneSnapshotContents contents;
+  contents.generatorKey = SceneGeneratorKey();
+  contents.instances = g_instanceBuffer.data();
+  contents.bounds = bounds.data();
+  contents.instanceCount = g_instanceCount;
+  contents.octreeNodes = g_linearOctree.Nodes().data();
+  contents.octreeNodeCount = g_linearOctree.Nodes().size();
+  contents.octreeObjects = g_linearOctree.ObjectIndices().data();
+  contents.octreeObjectCount = g_linearOctree.ObjectIndices().size();
+  return WriteSceneSnapshot(path, contents);
+}
+
+bool LoadSceneSnapshot(const std::string& path, size_t instanceCount)
+{
+  SceneSnapshot snapshot;
+  if (!snapshot.Open(path) || snapshot.Contents().instanceCount != instanceCount ||
+      snapshot.Contents().generatorKey != SceneGeneratorKey()) {
+    return false;
+  }
+  const SceneSnapshotContents& contents = snapshot.Contents();
+
+  // Instance update rewrites these arrays in place and the scene info carries octree pointers, so
+  // they are copied out of the mapping once instead of being used from it
+  ResizeInstanceState(instanceCount);
+  g_instanceBuffer.assign(contents.instances, contents.instances + instanceCount);
+  constexpr size_t kMinGrain = 4096;
+  dxh::JobSystem::Shared().ParallelFor(
+    0, instanceCount,
+    [&](size_t first, size_t last) {
+      for (size_t i = first; i < last; ++i) {
+        const InstanceBounds& bounds = contents.bounds[i];
+        InstanceSceneInfo& info = g_instanceSceneInfo[i];
+        info.worldPosition = bounds.worldPosition;
+        info.worldAABB = bounds.worldAABB;
+        info.worldSphere = bounds.worldSphere;
+        info.worldOBB = bounds.worldOBB;
+        info.instanceIndex = i;
+        g_instanceBoundsSoA.Set(i, bounds.worldAABB);
+      }
+    },
+    kMinGrain
+  );
+
+  g_linearOctree.Assign(
+    contents.octreeNodes, contents.octreeNodeCount, contents.octreeObjects,
+    contents.octreeObjectCount
+  );
+  g_linearOctreeVersion = g_instanceBoundsVersion;
+  return true;
+}
 
 void CullInstances(
   const dxh::PerspectiveCamera& cam,
@@ -326,6 +1130,12 @@ void CullInstances(
 )
 {
   g_culledInstanceIndices = g_initInstanceIndices;
+  g_acceptedInstanceCount = 0;
+  g_planeCoherencyStats = {};
+  g_tightBoundsStats = {};
+  g_lodStats = {};
+  g_cullTimings = {};
+  ++g_cullCounter;
 
 #if defined(LOG_OCTREE)
   g_logger->info("Culling instances...");
@@ -336,6 +1146,7 @@ void CullInstances(
     float octreeBuildTime = 0;
     float octreeCullTime = 0;
     bool isDynamic = acceleration == CullingAcceleration::DynamicOctree;
+    size_t dirtyCount = 0;
     size_t detachCount = 0;
     {
       DXH_SCOPED_AUTO_TIMER_OUT_RESULT(octreeBuildTime, dxh::Microseconds);
@@ -344,22 +1155,21 @@ void CullInstances(
         g_octreeBuilt = true;
       } else {
         if (isDynamic) {
-          for (size_t i = 0; i < g_instanceCount; ++i) {
-            bool detachTriggerd = UpdateOctreeObject(*g_sceneOctree, g_instanceSceneInfo[i]);
-            if (detachTriggerd) {
-              ++detachCount;
-            }
-          }
+          dirtyCount = g_octreeDirtyList.size();
+          detachCount = FlushOctreeDirtyList(g_sceneOctree, g_octreeDirtyList);
         }
       }
     }
     {
       DXH_SCOPED_AUTO_TIMER_OUT_RESULT(octreeCullTime, dxh::Microseconds);
-      CullOctreeNodes(cam, g_sceneOctree.get());
+      CullOctreeNodes(cam, &g_sceneOctree.root);
     }
+    g_cullTimings.accelerationUpdate = octreeBuildTime;
+    g_cullTimings.traversal = octreeCullTime;
 #if defined(LOG_OCTREE)
     g_logger->info("  Octree build/update time: {} ms", octreeBuildTime / 1000.f);
     if (isDynamic) {
+      g_logger->info("    *Octree dynamic update dirty count: {}", dirtyCount);
       g_logger->info("    *Octree dynamic update detach count: {}", detachCount);
     }
     g_logger->info("  Octree culling time: {} ms", octreeCullTime / 1000.f);
@@ -367,6 +1177,94 @@ void CullInstances(
 #endif
   }
 
+  if (acceleration == CullingAcceleration::LinearOctree) {
+    float octreeBuildTime = 0;
+    float octreeCullTime = 0;
+    {
+      DXH_SCOPED_AUTO_TIMER_OUT_RESULT(octreeBuildTime, dxh::Microseconds);
+      if (g_linearOctreeVersion != g_instanceBoundsVersion || g_linearOctree.Empty()) {
+        g_linearOctree.Build(g_instanceBoundsSoA);
+        g_linearOctreeVersion = g_instanceBoundsVersion;
+      }
+    }
+    {
+      DXH_SCOPED_AUTO_TIMER_OUT_RESULT(octreeCullTime, dxh::Microseconds);
+      CullLinearOctree(cam);
+    }
+    g_cullTimings.accelerationUpdate = octreeBuildTime;
+    g_cullTimings.traversal = octreeCullTime;
+#if defined(LOG_OCTREE)
+    g_logger->info("  Linear octree build time: {} ms", octreeBuildTime / 1000.f);
+    g_logger->info("    Node count: {}", g_linearOctree.Nodes().size());
+    g_logger->info("  Linear octree culling time: {} ms", octreeCullTime / 1000.f);
+    g_logger->info("    Instances left: {}", g_culledInstanceIndices.size());
+#endif
+  }
+
+  if (acceleration == CullingAcceleration::BVH) {
+    float bvhUpdateTime = 0;
+    float bvhCullTime = 0;
+    bool rebuilt = false;
+    {
+      DXH_SCOPED_AUTO_TIMER_OUT_RESULT(bvhUpdateTime, dxh::Microseconds);
+      // Moving instances only refit the tree, a full rebuild happens when the refitted tree got
+      // too loose
+      if (g_bvh.Empty()) {
+        g_bvh.Build(g_instanceBoundsSoA);
+        rebuilt = true;
+      } else if (g_bvhVersion != g_instanceBoundsVersion) {
+        rebuilt = g_bvh.Update(g_instanceBoundsSoA);
+      }
+      g_bvhVersion = g_instanceBoundsVersion;
+    }
+    {
+      DXH_SCOPED_AUTO_TIMER_OUT_RESULT(bvhCullTime, dxh::Microseconds);
+      CullBvh(cam);
+    }
+    g_cullTimings.accelerationUpdate = bvhUpdateTime;
+    g_cullTimings.traversal = bvhCullTime;
+#if defined(LOG_OCTREE)
+    g_logger->info("  BVH {} time: {} ms", rebuilt ? "build" : "refit", bvhUpdateTime / 1000.f);
+    g_logger->info(
+      "    Node count: {}, SAH cost: {} (built at {})",
+      g_bvh.Nodes().size(),
+      g_bvh.SahCost(),
+      g_bvh.BuildSahCost()
+    );
+    g_logger->info("  BVH culling time: {} ms", bvhCullTime / 1000.f);
+    g_logger->info("    Instances left: {}", g_culledInstanceIndices.size());
+#endif
+  }
+
+  if (acceleration == CullingAcceleration::UniformGrid) {
+    float gridUpdateTime = 0;
+    float gridCullTime = 0;
+    {
+      DXH_SCOPED_AUTO_TIMER_OUT_RESULT(gridUpdateTime, dxh::Microseconds);
+      if (g_uniformGrid.Empty()) {
+        g_uniformGrid.Build(g_instanceBoundsSoA, SceneBox(), GridCellSize());
+        ClearGridDirtyList();
+      } else if (g_uniformGridVersion != g_instanceBoundsVersion) {
+        // Only instances that left their cell, queued by UpdateInstances
+        g_uniformGrid.Update(g_instanceBoundsSoA, g_gridDirtyList);
+        ClearGridDirtyList();
+      }
+      g_uniformGridVersion = g_instanceBoundsVersion;
+    }
+    {
+      DXH_SCOPED_AUTO_TIMER_OUT_RESULT(gridCullTime, dxh::Microseconds);
+      CullUniformGrid(cam);
+    }
+    g_cullTimings.accelerationUpdate = gridUpdateTime;
+    g_cullTimings.traversal = gridCullTime;
+#if defined(LOG_OCTREE)
+    g_logger->info("  Uniform grid update time: {} ms", gridUpdateTime / 1000.f);
+    g_logger->info("    Cells: {} x {}", g_uniformGrid.ColumnCount(), g_uniformGrid.RowCount());
+    g_logger->info("  Uniform grid culling time: {} ms", gridCullTime / 1000.f);
+    g_logger->info("    Instances left: {}", g_culledInstanceIndices.size());
+#endif
+  }
+
   float cullTime = 0.f;
   {
     DXH_SCOPED_AUTO_TIMER_OUT_RESULT(cullTime, dxh::Microseconds);
@@ -377,13 +1275,78 @@ void CullInstances(
       case FrustumCullingSpace::World:
         CullInstancesWorldSpace(cam);
         break;
+      case FrustumCullingSpace::WorldPacket:
+        CullInstancesWorldSpacePacket(cam, acceleration == CullingAcceleration::None);
+        break;
+      case FrustumCullingSpace::LocalParallel:
+        CullInstancesLocalSpaceParallel(cam);
+        break;
+      case FrustumCullingSpace::WorldParallel:
+        CullInstancesWorldSpaceParallel(cam, acceleration == CullingAcceleration::None);
+        break;
       default:
         break;
     }
   }
 
+  float occlusionTime = 0.f;
+  g_occlusionStats = {};
+  if (g_enableOcclusionCulling && !g_culledInstanceIndices.empty()) {
+    DXH_SCOPED_AUTO_TIMER_OUT_RESULT(occlusionTime, dxh::Microseconds);
+    CullInstancesOcclusion(cam);
+  }
+
+  float lodTime = 0.f;
+  if (g_enableLodSelection) {
+    DXH_SCOPED_AUTO_TIMER_OUT_RESULT(lodTime, dxh::Microseconds);
+    BucketInstancesByLod(cam);
+  } else {
+    g_lodRanges.assign(1, {0, g_culledInstanceIndices.size()});
+  }
+  g_cullTimings.perObject = cullTime;
+  g_cullTimings.occlusion = occlusionTime;
+  g_cullTimings.lod = lodTime;
+
 #if defined(LOG_OCTREE)
   g_logger->info("  Per-object culling time: {} ms", cullTime / 1000.f);
+  if (g_planeCoherencyStats.planeTests > 0) {
+    g_logger->info(
+      "    Plane tests: {}, rejections: {}, cached plane hit rate: {}",
+      g_planeCoherencyStats.planeTests,
+      g_planeCoherencyStats.rejections,
+      g_planeCoherencyStats.HitRate()
+    );
+  }
+  if (g_tightBoundsStats.sphereRejections + g_tightBoundsStats.obbTests > 0) {
+    g_logger->info(
+      "    Sphere rejections: {}, OBB tests: {}, OBB rejections: {}, removed vs AABB: {}",
+      g_tightBoundsStats.sphereRejections,
+      g_tightBoundsStats.obbTests,
+      g_tightBoundsStats.obbRejections,
+      g_tightBoundsStats.aabbFalsePositives
+    );
+  }
+  if (g_enableOcclusionCulling) {
+    g_logger->info("  Occlusion culling time: {} ms", occlusionTime / 1000.f);
+    g_logger->info(
+      "    Occluders: {}, occluded: {} of {}",
+      g_occlusionStats.occluderCount,
+      g_occlusionStats.occludedCount,
+      g_occlusionStats.testedCount
+    );
+  }
+  if (g_enableLodSelection) {
+    g_logger->info("  LOD selection time: {} ms", lodTime / 1000.f);
+    g_logger->info(
+      "    Culled nodes: {}, bulk assigned: {}, dropped: {}",
+      g_lodStats.culledNodeCount,
+      g_lodStats.bulkAssignedCount,
+      g_lodStats.droppedCount
+    );
+    for (size_t lod = 0; lod < g_lodRanges.size(); ++lod) {
+      g_logger->info("    LOD {}: {}", lod, g_lodRanges[lod].count);
+    }
+  }
   g_logger->info("    Final instances after culling: {}", g_culledInstanceIndices.size());
   g_logger->info("Culling done.\n");
 #endif
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <string>
+
 #include "Camera.h"
 #include "Culling.h"
 #include "PCH.h"
@@ -18,9 +20,12 @@ struct InstanceData {
 struct InstanceSceneInfo {
   DirectX::XMFLOAT3 worldPosition;
   AABB worldAABB;
+  Sphere worldSphere;
+  OBB worldOBB;
   size_t instanceIndex = -1;
   OctreeNode<InstanceSceneInfo>* octreeNode = nullptr;
   size_t indexInNode = 0;
+  bool octreeDirty = false;  // Queued for a dynamic octree update
 };
 
 extern size_t g_instanceCount;
@@ -29,10 +34,107 @@ extern std::vector<InstanceData> g_instanceBuffer;
 extern std::vector<size_t> g_culledInstanceIndices;
 extern size_t g_cullCounter;
 
+// Writes g_culledInstanceIndices narrowed to 32 bits, e.g. into a mapped upload buffer
+void StoreCulledInstanceIndices(uint32_t* dst);
+
 void UpdateInstances(float time);
 
-enum class FrustumCullingSpace : uint8_t { None, Local, World };
-enum class CullingAcceleration : uint8_t { None, StaticOctree, DynamicOctree };
+// Regenerates the field with `instanceCount` instances and drops every acceleration structure,
+// e.g. to measure several scene sizes in one process. Bounds are valid after UpdateInstances
+void ResetInstances(size_t instanceCount);
+
+// Writes instances, their bounds and the linear octree built over them to a scene snapshot
+bool SaveSceneSnapshot(const std::string& path);
+
+// Replaces the scene with a snapshot written by SaveSceneSnapshot, bounds and linear octree are
+// valid right away. False when the file is missing, incompatible or holds another instance count
+bool LoadSceneSnapshot(const std::string& path, size_t instanceCount);
+
+enum class FrustumCullingSpace : uint8_t {
+  None,
+  Local,
+  World,
+  WorldPacket,
+  LocalParallel,
+  WorldParallel
+};
+
+// Most threads the parallel culling modes and the instance update run on at once, 0 uses every job
+// system participant and 1 runs on the calling thread
+extern size_t g_cullThreadCount;
+
+// World and local space per-object tests start with the plane that rejected an instance last frame
+extern bool g_usePlaneCoherency;
+
+// Per-object plane tests of the last CullInstances call
+extern PlaneCoherencyStats g_planeCoherencyStats;
+
+// World space per-object tests use the bounding sphere of each instance and its OBB where the
+// sphere straddles a plane, instead of the world AABB inflated by rotation
+extern bool g_useTightBounds;
+
+// Sphere and OBB tests of the last CullInstances call
+extern TightBoundsStats g_tightBoundsStats;
+
+enum class CullingAcceleration : uint8_t {
+  None,
+  StaticOctree,
+  DynamicOctree,
+  LinearOctree,
+  BVH,
+  UniformGrid
+};
+
+// After frustum culling, the g_occluderCount nearest survivors are rasterized into a CPU depth
+// buffer g_occlusionBufferWidth pixels wide and survivors hidden behind them are dropped
+extern bool g_enableOcclusionCulling;
+extern size_t g_occluderCount;
+extern int g_occlusionBufferWidth;
+
+struct OcclusionStats {
+  size_t occluderCount = 0;
+  size_t testedCount = 0;
+  size_t occludedCount = 0;
+};
+
+// Occlusion stage of the last CullInstances call
+extern OcclusionStats g_occlusionStats;
+
+// Survivors of culling are bucketed by the projected pixel diameter of their bounding sphere on a
+// g_lodScreenHeight pixels tall screen. LOD i is used down to g_lodPixelSizes[i] pixels, smaller
+// instances are dropped. The octree applies the same test to its nodes
+extern bool g_enableLodSelection;
+extern int g_lodScreenHeight;
+extern std::vector<float> g_lodPixelSizes;
+
+// Part of g_culledInstanceIndices drawn with one LOD
+struct LodRange {
+  size_t offset = 0;
+  size_t count = 0;
+};
+
+// One range per LOD, g_culledInstanceIndices is ordered by LOD after CullInstances
+extern std::vector<LodRange> g_lodRanges;
+
+struct LodStats {
+  size_t culledNodeCount = 0;    // Octree nodes dropped as too small
+  size_t bulkAssignedCount = 0;  // Instances given the LOD of their octree node
+  size_t droppedCount = 0;       // Instances dropped as too small by the per-object pass
+};
+
+// LOD stage of the last CullInstances call
+extern LodStats g_lodStats;
+
+// Stage timings of the last CullInstances call in microseconds, 0 for stages that did not run
+struct CullTimings {
+  float accelerationUpdate = 0.f;  // Build, update or refit of the acceleration structure
+  float traversal = 0.f;           // Hierarchy or grid traversal
+  float perObject = 0.f;           // Per-object frustum tests
+  float occlusion = 0.f;
+  float lod = 0.f;
+};
+
+extern CullTimings g_cullTimings;
 
 extern bool g_octreeBuilt;
 
@@ -0,0 +1,234 @@
+#include "LinearOctree.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cfloat>
+
+namespace
+{
+
+// Spreads the lower 10 bits of v so there are two zero bits between each
+uint32_t ExpandBits(uint32_t v)
+{
+  v &= 0x3FF;
+  v = (v | (v << 16)) & 0x030000FF;
+  v = (v | (v << 8)) & 0x0300F00F;
+  v = (v | (v << 4)) & 0x030C30C3;
+  v = (v | (v << 2)) & 0x09249249;
+  return v;
+}
+
+uint32_t Quantize(float value, float min, float scale)
+{
+  float q = (value - min) * scale;
+  return static_cast<uint32_t>(std::clamp(q, 0.f, 1023.f));
+}
+
+}  // namespace
+
+uint32_t MortonCode3D(uint32_t x, uint32_t y, uint32_t z)
+{
+  return (ExpandBits(x) << 2) | (ExpandBits(y) << 1) | ExpandBits(z);
+}
+
+void RadixSort30(
+  std::vector<uint32_t>& keys,
+  std::vector<uint32_t>& values,
+  std::vector<uint32_t>& keysTemp,
+  std::vector<uint32_t>& valuesTemp
+)
+{
+  constexpr int kDigitBits = 10;
+  constexpr int kPassCount = 3;
+  constexpr uint32_t kBucketCount = 1u << kDigitBits;
+  constexpr uint32_t kDigitMask = kBucketCount - 1;
+
+  assert(keys.size() == values.size());
+  size_t count = keys.size();
+  keysTemp.resize(count);
+  valuesTemp.resize(count);
+
+  // All three histograms in a single read of the keys
+  std::vector<std::array<uint32_t, kBucketCount>> histograms(kPassCount);
+  for (auto& histogram : histograms) {
+    histogram.fill(0);
+  }
+  for (uint32_t key : keys) {
+    for (int pass = 0; pass < kPassCount; ++pass) {
+      ++histograms[pass][(key >> (pass * kDigitBits)) & kDigitMask];
+    }
+  }
+
+  for (int pass = 0; pass < kPassCount; ++pass) {
+    auto& histogram = histograms[pass];
+    int shift = pass * kDigitBits;
+
+    // Keys all share this digit, pass would be a plain copy
+    if (histogram[(keys.empty() ? 0 : keys[0] >> shift) & kDigitMask] == count) {
+      continue;
+    }
+
+    uint32_t offset = 0;
+    for (uint32_t& bucket : histogram) {
+      uint32_t bucketCount = bucket;
+      bucket = offset;
+      offset += bucketCount;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+      uint32_t dst = histogram[(keys[i] >> shift) & kDigitMask]++;
+      keysTemp[dst] = keys[i];
+      valuesTemp[dst] = values[i];
+    }
+    keys.swap(keysTemp);
+    values.swap(valuesTemp);
+  }
+}
+
+void LinearOctree::Build(const AABBSoA& bounds)
+{
+  nodes.clear();
+  size_t count = bounds.Size();
+  if (count == 0) {
+    objectIndices.clear();
+    return;
+  }
+
+  // Centers are the box midpoints per axis
+  float centerMin[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+  float centerMax[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+  const float* mins[3] = {bounds.minX.data(), bounds.minY.data(), bounds.minZ.data()};
+  const float* maxs[3] = {bounds.maxX.data(), bounds.maxY.data(), bounds.maxZ.data()};
+  for (int axis = 0; axis < 3; ++axis) {
+    const float* pmin = mins[axis];
+    const float* pmax = maxs[axis];
+    float lo = FLT_MAX;
+    float hi = -FLT_MAX;
+    for (size_t i = 0; i < count; ++i) {
+      float center = (pmin[i] + pmax[i]) * 0.5f;
+      lo = std::min(lo, center);
+      hi = std::max(hi, center);
+    }
+    centerMin[axis] = lo;
+    centerMax[axis] = hi;
+  }
+
+  codes.assign(count, 0);
+  objectIndices.resize(count);
+  for (int axis = 0; axis < 3; ++axis) {
+    const float* pmin = mins[axis];
+    const float* pmax = maxs[axis];
+    float extent = centerMax[axis] - centerMin[axis];
+    float scale = extent > 0.f ? 1023.f / extent : 0.f;
+    float offset = centerMin[axis];
+    int bitShift = 2 - axis;
+    for (size_t i = 0; i < count; ++i) {
+      float center = (pmin[i] + pmax[i]) * 0.5f;
+      codes[i] |= ExpandBits(Quantize(center, offset, scale)) << bitShift;
+    }
+  }
+  for (size_t i = 0; i < count; ++i) {
+    objectIndices[i] = static_cast<uint32_t>(i);
+  }
+
+  RadixSort30(codes, objectIndices, codesTemp, indicesTemp);
+
+  // Gather bounds once in Morton order so leaves read them sequentially
+  sortedBounds.resize(count);
+  for (size_t i = 0; i < count; ++i) {
+    sortedBounds[i] = bounds.Get(objectIndices[i]);
+  }
+
+  nodes.reserve(2 * count / kLeafObjectCount + 1);
+  BuildNode(0, static_cast<uint32_t>(count), 0);
+}
+
+void LinearOctree::Assign(
+  const LinearOctreeNode* srcNodes,
+  size_t nodeCount,
+  const uint32_t* srcObjectIndices,
+  size_t objectCount
+)
+{
+  nodes.assign(srcNodes, srcNodes + nodeCount);
+  objectIndices.assign(srcObjectIndices, srcObjectIndices + objectCount);
+}
+
+AABB LinearOctree::BuildNode(uint32_t first, uint32_t count, int depth)
+{
+  auto nodeIndex = static_cast<uint32_t>(nodes.size());
+  nodes.emplace_back();
+  nodes[nodeIndex].firstObject = first;
+  nodes[nodeIndex].objectCount = count;
+  nodes[nodeIndex].depth = static_cast<uint8_t>(depth);
+
+  AABB box;
+  if (count <= kLeafObjectCount || depth == kMaxDepth) {
+    nodes[nodeIndex].leaf = true;
+    box = sortedBounds[first];
+    for (uint32_t i = first + 1; i < first + count; ++i) {
+      box = MergeAABB(box, sortedBounds[i]);
+    }
+  } else {
+    // Codes in this range share their top 3 * depth bits, split on the next octal digit
+    int shift = 3 * (kMaxDepth - 1 - depth);
+    auto begin = codes.begin() + first;
+    auto end = begin + count;
+    bool firstChild = true;
+    while (begin != end) {
+      uint32_t digit = (*begin >> shift) & 7;
+      auto childEnd = std::partition_point(begin, end, [shift, digit](uint32_t code) {
+        return ((code >> shift) & 7) == digit;
+      });
+      auto childFirst = static_cast<uint32_t>(begin - codes.begin());
+      auto childCount = static_cast<uint32_t>(childEnd - begin);
+      AABB childBox = BuildNode(childFirst, childCount, depth + 1);
+      box = firstChild ? childBox : MergeAABB(box, childBox);
+      firstChild = false;
+      begin = childEnd;
+    }
+  }
+
+  nodes[nodeIndex].bbox = box;
+  nodes[nodeIndex].skip = static_cast<uint32_t>(nodes.size());
+  return box;
+}
+
+void LinearOctree::Cull(
+  const Frustum& frustum,
+  std::vector<size_t>& outAccepted,
+  std::vector<size_t>& outCandidates
+) const
+{
+  auto appendObjects = [this](const LinearOctreeNode& node, std::vector<size_t>& out) {
+    for (uint32_t k = node.firstObject; k < node.firstObject + node.objectCount; ++k) {
+      out.push_back(objectIndices[k]);
+    }
+  };
+
+  // Pre-order walk, the last node seen one level up is always the parent, so plane masks are kept
+  // per depth instead of on a stack
+  uint8_t planeMasks[kMaxDepth + 1];
+
+  size_t i = 0;
+  while (i < nodes.size()) {
+    const LinearOctreeNode& node = nodes[i];
+    uint8_t mask = node.depth == 0 ? kAllFrustumPlanes : planeMasks[node.depth - 1];
+    CullResult result = ClassifyAABB(node.bbox, frustum, mask);
+    if (result == CullResult::Outside) {
+      i = node.skip;
+      continue;
+    }
+    if (result == CullResult::Inside) {
+      appendObjects(node, outAccepted);
+      i = node.skip;
+      continue;
+    }
+    if (node.leaf) {
+      appendObjects(node, outCandidates);
+    }
+    planeMasks[node.depth] = mask;
+    ++i;
+  }
+}
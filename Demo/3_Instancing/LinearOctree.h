@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Culling.h"
+#include "PacketCulling.h"
+
+// Node of a pointerless octree. Nodes are stored in pre-order, which for an octree split on Morton
+// code digits is also Morton order, so every subtree is a contiguous run of nodes and its objects
+// are a contiguous range of LinearOctree::ObjectIndices()
+struct LinearOctreeNode {
+  AABB bbox;                 // Tight bounds of all objects in the subtree
+  uint32_t firstObject = 0;  // Object range of the whole subtree
+  uint32_t objectCount = 0;
+  uint32_t skip = 0;  // Index of the first node after this subtree
+  uint8_t depth = 0;
+  bool leaf = false;
+};
+
+class LinearOctree
+{
+public:
+  static constexpr int kMaxDepth = 10;  // 10 bits per axis in a 30-bit Morton code
+  static constexpr uint32_t kLeafObjectCount = 32;
+
+  // Sorts objects by the Morton code of their box centers and builds nodes top-down over the
+  // sorted codes. Object i of `bounds` is reported as index i
+  void Build(const AABBSoA& bounds);
+
+  // Appends objects of subtrees fully inside the frustum to `outAccepted`, they need no further
+  // test, and objects of leaves only intersecting it to `outCandidates`
+  void Cull(
+    const Frustum& frustum,
+    std::vector<size_t>& outAccepted,
+    std::vector<size_t>& outCandidates
+  ) const;
+
+  // Adopts nodes and object indices built earlier, e.g. by a scene snapshot
+  void Assign(
+    const LinearOctreeNode* srcNodes,
+    size_t nodeCount,
+    const uint32_t* srcObjectIndices,
+    size_t objectCount
+  );
+
+  bool Empty() const { return nodes.empty(); }
+
+  const std::vector<LinearOctreeNode>& Nodes() const { return nodes; }
+  const std::vector<uint32_t>& ObjectIndices() const { return objectIndices; }
+
+private:
+  AABB BuildNode(uint32_t first, uint32_t count, int depth);
+
+  std::vector<LinearOctreeNode> nodes;
+  std::vector<uint32_t> objectIndices;
+
+  // Build buffers, kept between builds
+  std::vector<AABB> sortedBounds;
+  std::vector<uint32_t> codes;
+  std::vector<uint32_t> codesTemp;
+  std::vector<uint32_t> indicesTemp;
+};
+
+uint32_t MortonCode3D(uint32_t x, uint32_t y, uint32_t z);
+
+// LSD radix sort of 30-bit keys carrying values along, temp buffers are resized as needed
+void RadixSort30(
+  std::vector<uint32_t>& keys,
+  std::vector<uint32_t>& values,
+  std::vector<uint32_t>& keysTemp,
+  std::vector<uint32_t>& valuesTemp
+);
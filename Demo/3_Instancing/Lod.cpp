@@ -0,0 +1,62 @@
+#include "Lod.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+
+using namespace DirectX;
+
+LodSelector::LodSelector(
+  const dxh::PerspectiveCamera& cam,
+  int screenHeight,
+  const std::vector<float>& pixelSizes
+)
+    : eye(cam.position),
+      pixelScale(static_cast<float>(screenHeight) / std::tan(cam.fovY * 0.5f)),
+      pixelSizes(pixelSizes)
+{
+  assert(!pixelSizes.empty() && pixelSizes.size() <= kMaxLodCount);
+  assert(std::is_sorted(pixelSizes.rbegin(), pixelSizes.rend()));
+}
+
+uint8_t LodSelector::SelectLod(float pixelSize) const
+{
+  for (size_t i = 0; i < pixelSizes.size(); ++i) {
+    if (pixelSize >= pixelSizes[i]) {
+      return static_cast<uint8_t>(i);
+    }
+  }
+  return kLodCulled;
+}
+
+uint8_t LodSelector::SelectLod(const XMFLOAT3& center, float radius) const
+{
+  XMVECTOR xmOffset = XMVectorSubtract(XMLoadFloat3(&center), XMLoadFloat3(&eye));
+  float distance = XMVectorGetX(XMVector3Length(xmOffset));
+  return SelectLod(distance > radius ? PixelSize(radius, distance) : FLT_MAX);
+}
+
+uint8_t LodSelector::SelectBoxLod(const AABB& box, float minRadius, float maxRadius) const
+{
+  XMVECTOR xmEye = XMLoadFloat3(&eye);
+  XMVECTOR xmMin = XMLoadFloat3(&box.min);
+  XMVECTOR xmMax = XMLoadFloat3(&box.max);
+
+  // Nearest point of the box and its farthest corner bound the distance of every center inside
+  XMVECTOR xmNearest = XMVectorClamp(xmEye, xmMin, xmMax);
+  float nearDistance = XMVectorGetX(XMVector3Length(XMVectorSubtract(xmNearest, xmEye)));
+  XMVECTOR xmFarOffset = XMVectorMax(
+    XMVectorAbs(XMVectorSubtract(xmMin, xmEye)), XMVectorAbs(XMVectorSubtract(xmMax, xmEye))
+  );
+  float farDistance = XMVectorGetX(XMVector3Length(xmFarOffset));
+
+  float largest = nearDistance > maxRadius ? PixelSize(maxRadius, nearDistance) : FLT_MAX;
+  uint8_t nearLod = SelectLod(largest);
+  if (nearLod == kLodCulled) {
+    return kLodCulled;
+  }
+  float smallest = farDistance > minRadius ? PixelSize(minRadius, farDistance) : FLT_MAX;
+  uint8_t farLod = SelectLod(smallest);
+  return nearLod == farLod ? nearLod : kLodMixed;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Camera.h"
+#include "Culling.h"
+
+constexpr size_t kMaxLodCount = 8;
+
+// Returned instead of a LOD when every object is smaller than the last pixel threshold
+constexpr uint8_t kLodCulled = 0xFF;
+
+// Returned by LodSelector::SelectBoxLod when objects of the box may need different LODs
+constexpr uint8_t kLodMixed = 0xFE;
+
+// Picks levels of detail from the projected size of bounding spheres. The size is the sphere
+// diameter in pixels at its distance from the eye, LOD i is used down to pixelSizes[i] pixels and
+// objects below the last entry are dropped
+class LodSelector
+{
+public:
+  // `pixelSizes` holds one descending threshold per LOD, at most kMaxLodCount
+  LodSelector(
+    const dxh::PerspectiveCamera& cam,
+    int screenHeight,
+    const std::vector<float>& pixelSizes
+  );
+
+  // Projected diameter in pixels of a sphere at `distance` from the eye
+  float PixelSize(float radius, float distance) const { return radius * pixelScale / distance; }
+
+  uint8_t SelectLod(float pixelSize) const;
+  uint8_t SelectLod(const DirectX::XMFLOAT3& center, float radius) const;
+
+  // Common LOD of every sphere centered inside `box` with a radius within [minRadius, maxRadius],
+  // kLodCulled if all of them are dropped and kLodMixed if they may differ
+  uint8_t SelectBoxLod(const AABB& box, float minRadius, float maxRadius) const;
+
+  size_t LodCount() const { return pixelSizes.size(); }
+
+private:
+  DirectX::XMFLOAT3 eye;
+  float pixelScale;  // screenHeight / tan(fovY / 2), maps radius over distance to a pixel diameter
+  std::vector<float> pixelSizes;
+};
@@ -0,0 +1,262 @@
+#include "OcclusionCulling.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+
+#include "JobSystem.h"
+
+using namespace DirectX;
+
+namespace
+{
+
+// Pixel holding screen coordinate v, clamped to [-1, size] so far off-screen coordinates stay
+// representable
+int PixelCoord(float v, int size)
+{
+  return static_cast<int>(std::clamp(std::floor(v), -1.f, static_cast<float>(size)));
+}
+
+}  // namespace
+
+void OcclusionBuffer::Resize(int newWidth, int newHeight)
+{
+  assert(newWidth > 0 && newHeight > 0);
+  width = newWidth;
+  height = newHeight;
+  tileCountX = (width + kTileWidth - 1) / kTileWidth;
+  tileCountY = (height + kTileHeight - 1) / kTileHeight;
+  depths.resize(static_cast<size_t>(tileCountX) * tileCountY * kTilePixelCount);
+  tileMaxDepths.resize(static_cast<size_t>(tileCountX) * tileCountY);
+  Clear();
+}
+
+void OcclusionBuffer::Clear()
+{
+  std::fill(depths.begin(), depths.end(), 1.f);
+  std::fill(tileMaxDepths.begin(), tileMaxDepths.end(), 1.f);
+}
+
+OcclusionBuffer::ScreenVertex OcclusionBuffer::ToScreen(FXMVECTOR clip) const
+{
+  XMFLOAT4 c;
+  XMStoreFloat4(&c, clip);
+  if (c.z < 0.f || c.w <= 0.f) {
+    return {0.f, 0.f, 0.f, true};
+  }
+  float invW = 1.f / c.w;
+  float x = (c.x * invW * 0.5f + 0.5f) * static_cast<float>(width);
+  float y = (0.5f - c.y * invW * 0.5f) * static_cast<float>(height);
+  return {x, y, c.z * invW, false};
+}
+
+void OcclusionBuffer::RasterizeOccluders(
+  const XMMATRIX* worldViewProjs,
+  size_t occluderCount,
+  const XMFLOAT3* positions,
+  size_t vertexCount,
+  const uint16_t* indices,
+  size_t indexCount
+)
+{
+  dxh::JobSystem& jobSystem = dxh::JobSystem::Shared();
+
+  screenVertices.resize(occluderCount * vertexCount);
+  occluderRows.resize(occluderCount);
+  jobSystem.ParallelFor(
+    0, occluderCount,
+    [&](size_t first, size_t last) {
+      for (size_t k = first; k < last; ++k) {
+        ScreenVertex* vertices = screenVertices.data() + k * vertexCount;
+        RowSpan rows = {FLT_MAX, -FLT_MAX};
+        for (size_t i = 0; i < vertexCount; ++i) {
+          XMVECTOR xmPos = XMVectorSet(positions[i].x, positions[i].y, positions[i].z, 1.f);
+          vertices[i] = ToScreen(XMVector4Transform(xmPos, worldViewProjs[k]));
+          if (!vertices[i].clipped) {
+            rows = {std::min(rows.minY, vertices[i].y), std::max(rows.maxY, vertices[i].y)};
+          }
+        }
+        occluderRows[k] = rows;
+      }
+    },
+    64
+  );
+
+  // Bands own whole tile rows, so they write disjoint tiles
+  jobSystem.ParallelFor(0, static_cast<size_t>(tileCountY), [&](size_t first, size_t last) {
+    int rowBegin = static_cast<int>(first) * kTileHeight;
+    int rowEnd = std::min(height, static_cast<int>(last) * kTileHeight);
+    for (size_t k = 0; k < occluderCount; ++k) {
+      if (occluderRows[k].maxY < static_cast<float>(rowBegin) ||
+          occluderRows[k].minY >= static_cast<float>(rowEnd)) {
+        continue;
+      }
+      const ScreenVertex* vertices = screenVertices.data() + k * vertexCount;
+      for (size_t i = 0; i + 2 < indexCount; i += 3) {
+        RasterizeTriangle(
+          vertices[indices[i]], vertices[indices[i + 1]], vertices[indices[i + 2]], rowBegin,
+          rowEnd
+        );
+      }
+    }
+    UpdateHiZ(static_cast<int>(first), static_cast<int>(last));
+  });
+}
+
+void OcclusionBuffer::RasterizeTriangle(
+  ScreenVertex v0,
+  ScreenVertex v1,
+  ScreenVertex v2,
+  int rowBegin,
+  int rowEnd
+)
+{
+  if (v0.clipped || v1.clipped || v2.clipped) {
+    return;
+  }
+
+  // Both windings are drawn, the depth test keeps the front faces
+  float area = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+  if (area == 0.f) {
+    return;
+  }
+  if (area < 0.f) {
+    std::swap(v1, v2);
+    area = -area;
+  }
+
+  int minX = std::max(0, PixelCoord(std::min({v0.x, v1.x, v2.x}), width));
+  int maxX = std::min(width - 1, PixelCoord(std::max({v0.x, v1.x, v2.x}), width));
+  int minY = std::max(rowBegin, PixelCoord(std::min({v0.y, v1.y, v2.y}), height));
+  int maxY = std::min(rowEnd - 1, PixelCoord(std::max({v0.y, v1.y, v2.y}), height));
+  if (minX > maxX || minY > maxY) {
+    return;
+  }
+
+  // Edge functions a * x + b * y + c, non-negative inside. Edge i is opposite vertex i, so it
+  // divided by the area is the barycentric weight of vertex i
+  auto edge = [](const ScreenVertex& p, const ScreenVertex& q, float& a, float& b, float& c) {
+    a = p.y - q.y;
+    b = q.x - p.x;
+    c = p.x * q.y - p.y * q.x;
+  };
+  float a0, b0, c0, a1, b1, c1, a2, b2, c2;
+  edge(v1, v2, a0, b0, c0);
+  edge(v2, v0, a1, b1, c1);
+  edge(v0, v1, a2, b2, c2);
+
+  // A pixel is covered when the edge functions at its center clear half its extent along the
+  // edge normals, i.e. when the whole pixel square is inside
+  float inset0 = 0.5f * (std::fabs(a0) + std::fabs(b0));
+  float inset1 = 0.5f * (std::fabs(a1) + std::fabs(b1));
+  float inset2 = 0.5f * (std::fabs(a2) + std::fabs(b2));
+
+  // Depth is linear in screen space: z = z0 + (z1 - z0) * w1 + (z2 - z0) * w2. The farthest depth
+  // over a covered pixel is the center depth plus half the depth slope along x and y
+  float invArea = 1.f / area;
+  float dz1 = (v1.z - v0.z) * invArea;
+  float dz2 = (v2.z - v0.z) * invArea;
+  float depthBias = 0.5f * (std::fabs(dz1 * a1 + dz2 * a2) + std::fabs(dz1 * b1 + dz2 * b2));
+
+  int tileX0 = minX / kTileWidth;
+  int tileX1 = maxX / kTileWidth;
+  int tileY0 = minY / kTileHeight;
+  int tileY1 = maxY / kTileHeight;
+
+  for (int tileY = tileY0; tileY <= tileY1; ++tileY) {
+    for (int tileX = tileX0; tileX <= tileX1; ++tileX) {
+      size_t tileIndex = static_cast<size_t>(tileY) * tileCountX + tileX;
+      float* tile = depths.data() + tileIndex * kTilePixelCount;
+      for (int row = 0; row < kTileHeight; ++row) {
+        int py = tileY * kTileHeight + row;
+        if (py < minY || py > maxY) {
+          continue;
+        }
+        float sy = static_cast<float>(py) + 0.5f;
+        float* tileRow = tile + row * kTileWidth;
+
+        // One tile row per iteration, written as a masked minimum so it vectorizes
+        for (int lane = 0; lane < kTileWidth; ++lane) {
+          int px = tileX * kTileWidth + lane;
+          float sx = static_cast<float>(px) + 0.5f;
+          float w0 = a0 * sx + b0 * sy + c0;
+          float w1 = a1 * sx + b1 * sy + c1;
+          float w2 = a2 * sx + b2 * sy + c2;
+          bool covered =
+            w0 >= inset0 && w1 >= inset1 && w2 >= inset2 && px >= minX && px <= maxX;
+          float z = v0.z + dz1 * w1 + dz2 * w2 + depthBias;
+          tileRow[lane] = covered ? std::min(tileRow[lane], z) : tileRow[lane];
+        }
+      }
+    }
+  }
+}
+
+void OcclusionBuffer::UpdateHiZ(int tileRowBegin, int tileRowEnd)
+{
+  size_t tileBegin = static_cast<size_t>(tileRowBegin) * tileCountX;
+  size_t tileEnd = static_cast<size_t>(tileRowEnd) * tileCountX;
+  for (size_t tile = tileBegin; tile < tileEnd; ++tile) {
+    const float* tileDepths = depths.data() + tile * kTilePixelCount;
+    float maxDepth = tileDepths[0];
+    for (int i = 1; i < kTilePixelCount; ++i) {
+      maxDepth = std::max(maxDepth, tileDepths[i]);
+    }
+    tileMaxDepths[tile] = maxDepth;
+  }
+}
+
+bool OcclusionBuffer::TestAABB(const AABB& worldBox, const XMMATRIX& viewProj) const
+{
+  XMVECTOR xmPoints[8];
+  GetAABBPoints(worldBox, xmPoints);
+
+  float minX = FLT_MAX;
+  float maxX = -FLT_MAX;
+  float minY = FLT_MAX;
+  float maxY = -FLT_MAX;
+  float minDepth = FLT_MAX;
+  for (const auto& xmPoint : xmPoints) {
+    ScreenVertex v = ToScreen(XMVector4Transform(xmPoint, viewProj));
+    if (v.clipped) {
+      return true;
+    }
+    minX = std::min(minX, v.x);
+    maxX = std::max(maxX, v.x);
+    minY = std::min(minY, v.y);
+    maxY = std::max(maxY, v.y);
+    minDepth = std::min(minDepth, v.z);
+  }
+
+  // Every pixel the rectangle touches
+  int x0 = std::max(0, PixelCoord(minX, width));
+  int x1 = std::min(width - 1, PixelCoord(maxX, width));
+  int y0 = std::max(0, PixelCoord(minY, height));
+  int y1 = std::min(height - 1, PixelCoord(maxY, height));
+  if (x0 > x1 || y0 > y1) {
+    return false;
+  }
+
+  for (int tileY = y0 / kTileHeight; tileY <= y1 / kTileHeight; ++tileY) {
+    for (int tileX = x0 / kTileWidth; tileX <= x1 / kTileWidth; ++tileX) {
+      if (minDepth > TileMaxDepth(tileX, tileY)) {
+        continue;  // Every pixel of the tile is in front of the box
+      }
+
+      int px0 = std::max(x0, tileX * kTileWidth);
+      int px1 = std::min(x1, tileX * kTileWidth + kTileWidth - 1);
+      int py0 = std::max(y0, tileY * kTileHeight);
+      int py1 = std::min(y1, tileY * kTileHeight + kTileHeight - 1);
+      for (int py = py0; py <= py1; ++py) {
+        for (int px = px0; px <= px1; ++px) {
+          if (minDepth <= Depth(px, py)) {
+            return true;
+          }
+        }
+      }
+    }
+  }
+  return false;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Culling.h"
+
+// Low resolution depth buffer rasterized on the CPU. Pixels are stored tile by tile, a tile row of
+// kTileWidth depths maps to one 8-wide SIMD register and is updated under a coverage mask. Every
+// tile also keeps the farthest depth of its pixels, so occludees are first tested per tile and
+// only read single pixels in tiles where the coarse test is inconclusive. Occluders only cover
+// pixels they cover entirely, with their farthest depth over the pixel, so tests stay conservative.
+// Depth follows D3D conventions, 0 at the near plane and 1 at the far plane
+class OcclusionBuffer
+{
+public:
+  static constexpr int kTileWidth = 8;
+  static constexpr int kTileHeight = 4;
+  static constexpr int kTilePixelCount = kTileWidth * kTileHeight;
+
+  // Size in pixels, storage is rounded up to whole tiles
+  void Resize(int width, int height);
+
+  // Resets every pixel to the far plane
+  void Clear();
+
+  // Rasterizes `occluderCount` copies of an indexed triangle list, copy i transformed by
+  // worldViewProjs[i], and updates the farthest depth of every tile. Triangles crossing the near
+  // plane are skipped, which only makes occlusion less aggressive. Vertices are transformed and
+  // bands of tile rows rasterized in parallel on the shared job system
+  void RasterizeOccluders(
+    const DirectX::XMMATRIX* worldViewProjs,
+    size_t occluderCount,
+    const DirectX::XMFLOAT3* positions,
+    size_t vertexCount,
+    const uint16_t* indices,
+    size_t indexCount
+  );
+
+  // False only if the box is hidden behind occluders over its whole screen rectangle. Boxes
+  // crossing the near plane are always visible. Thread safe after RasterizeOccluders
+  bool TestAABB(const AABB& worldBox, const DirectX::XMMATRIX& viewProj) const;
+
+  int Width() const { return width; }
+  int Height() const { return height; }
+
+  float Depth(int x, int y) const { return depths[PixelIndex(x, y)]; }
+  float TileMaxDepth(int tileX, int tileY) const
+  {
+    return tileMaxDepths[static_cast<size_t>(tileY) * tileCountX + tileX];
+  }
+
+private:
+  struct ScreenVertex {
+    float x;
+    float y;
+    float z;
+    bool clipped;  // In front of the near plane
+  };
+
+  size_t PixelIndex(int x, int y) const
+  {
+    size_t tile = static_cast<size_t>(y / kTileHeight) * tileCountX + x / kTileWidth;
+    return tile * kTilePixelCount + (y % kTileHeight) * kTileWidth + x % kTileWidth;
+  }
+
+  // Pixel rows of screen vertices of one occluder, used to skip it in bands it does not touch
+  struct RowSpan {
+    float minY;
+    float maxY;
+  };
+
+  ScreenVertex ToScreen(DirectX::FXMVECTOR clip) const;
+
+  // Only pixel rows [rowBegin, rowEnd) are written
+  void RasterizeTriangle(
+    ScreenVertex v0,
+    ScreenVertex v1,
+    ScreenVertex v2,
+    int rowBegin,
+    int rowEnd
+  );
+
+  void UpdateHiZ(int tileRowBegin, int tileRowEnd);
+
+  int width = 0;
+  int height = 0;
+  int tileCountX = 0;
+  int tileCountY = 0;
+  std::vector<float> depths;  // Tile-major
+  std::vector<float> tileMaxDepths;
+  std::vector<ScreenVertex> screenVertices;  // Scratch of RasterizeOccluders, occluder-major
+  std::vector<RowSpan> occluderRows;
+};
@@ -1,6 +1,10 @@
 #pragma once
 
+#include <deque>
+#include <mutex>
+
 #include "Culling.h"
+#include "JobSystem.h"
 #include "PCH.h"
 
 #undef min
@@ -17,12 +21,28 @@ struct OctreeNode {
   OctreeNode* children[8]{};
   std::vector<ObjectType*> objects{};
   OctreeNode* parent{};
-  int depth;
+  int depth = 0;
 
   OctreeNode() = default;
-  explicit OctreeNode(const AABB& box, int depth, float looseFactor = 1.f) : depth{depth}
+  explicit OctreeNode(const AABB& box, int depth, float looseFactor = 1.f)
+  {
+    Reset(box, depth, looseFactor);
+  }
+
+  // Reinitializes a recycled node, capacity of the object list is kept
+  void Reset(
+    const AABB& box,
+    int nodeDepth,
+    float looseFactor = 1.f,
+    OctreeNode* parentNode = nullptr
+  )
   {
     using namespace DirectX;
+    std::fill(std::begin(children), std::end(children), nullptr);
+    objects.clear();
+    parent = parentNode;
+    depth = nodeDepth;
+
     auto xmMin = XMLoadFloat3(&box.min);
     auto xmMax = XMLoadFloat3(&box.max);
     auto xmCenter = XMVectorScale(XMVectorAdd(xmMin, xmMax), 0.5f);
@@ -108,6 +128,126 @@ struct OctreeNode {
   }
 };
 
+// Owns the nodes of one octree. Children of a node are always allocated as one block of eight
+// siblings, blocks live in chunks that are never returned to the system. Blocks released by a
+// collapsing subtree are reused by later subdivisions, and Reset() makes every block available
+// again in O(1). Recycled nodes keep the capacity of their object lists, so a rebuild of a
+// similar scene does no heap allocation
+template<typename ObjectType>
+class OctreeNodePool
+{
+public:
+  using Node = OctreeNode<ObjectType>;
+
+  static constexpr size_t kBlocksPerChunk = 512;
+
+  // Thread safe, used by the parallel bulk build
+  Node* AllocateChildren(const std::vector<AABB>& subBoxes, Node& parent, float looseFactor)
+  {
+    assert(subBoxes.size() == 8);
+
+    Node* block = nullptr;
+    {
+      std::lock_guard<std::mutex> lock{mutex};
+      if (!freeBlocks.empty()) {
+        block = freeBlocks.back();
+        freeBlocks.pop_back();
+      } else {
+        if (usedBlocks == chunks.size() * kBlocksPerChunk) {
+          chunks.push_back(std::make_unique<Node[]>(8 * kBlocksPerChunk));
+        }
+        block = &chunks[usedBlocks / kBlocksPerChunk][8 * (usedBlocks % kBlocksPerChunk)];
+        ++usedBlocks;
+      }
+    }
+
+    for (size_t i = 0; i < 8; ++i) {
+      block[i].Reset(subBoxes[i], parent.depth + 1, looseFactor, &parent);
+    }
+    return block;
+  }
+
+  // `block` is the first child returned by AllocateChildren
+  void ReleaseChildren(Node* block)
+  {
+    std::lock_guard<std::mutex> lock{mutex};
+    freeBlocks.push_back(block);
+  }
+
+  void Reset()
+  {
+    std::lock_guard<std::mutex> lock{mutex};
+    usedBlocks = 0;
+    freeBlocks.clear();
+  }
+
+  size_t LiveBlockCount() const { return usedBlocks - freeBlocks.size(); }
+
+  size_t ReservedNodeCount() const { return chunks.size() * kBlocksPerChunk * 8; }
+
+private:
+  std::vector<std::unique_ptr<Node[]>> chunks;
+  size_t usedBlocks = 0;
+  std::vector<Node*> freeBlocks;
+  std::mutex mutex;
+};
+
+template<typename ObjectType>
+struct Octree {
+  OctreeNode<ObjectType> root;
+  OctreeNodePool<ObjectType> pool;
+
+  // Objects of nodes being subdivided, one list per depth because reinserting them subdivides
+  // deeper nodes. A deque keeps references to shallower lists valid while it grows
+  std::deque<std::vector<ObjectType*>> reassignLists;
+
+  std::vector<ObjectType*>& ReassignList(int depth)
+  {
+    while (reassignLists.size() <= static_cast<size_t>(depth)) {
+      reassignLists.emplace_back();
+    }
+    return reassignLists[depth];
+  }
+
+  // Drops every node in one go, objects still pointing into the tree must be reset by the caller
+  void Reset(const AABB& sceneBox)
+  {
+    pool.Reset();
+    root.Reset(sceneBox, 0);
+  }
+};
+
+template<typename ObjectType>
+void SubdivideNode(Octree<ObjectType>& tree, OctreeNode<ObjectType>& node)
+{
+  assert(node.IsLeaf());
+  const auto& subBoxes = SubdivideBox(node.bbox);
+  OctreeNode<ObjectType>* block = tree.pool.AllocateChildren(subBoxes, node, 1.5f);
+  for (size_t i = 0; i < 8; ++i) {
+    assert(block[i].bbox.IsValid());
+    node.children[i] = &block[i];
+  }
+}
+
+// Returns the children of `node` to the pool, walking up while parents become empty leaves too
+template<typename ObjectType>
+void CollapseEmptyNodes(Octree<ObjectType>& tree, OctreeNode<ObjectType>* node)
+{
+  auto isEmptyLeaf = [](const OctreeNode<ObjectType>* n) {
+    return n->IsLeaf() && n->objects.empty();
+  };
+
+  while (node && !node->IsLeaf() &&
+         std::all_of(std::begin(node->children), std::end(node->children), isEmptyLeaf)) {
+    tree.pool.ReleaseChildren(node->children[0]);
+    std::fill(std::begin(node->children), std::end(node->children), nullptr);
+    if (!node->objects.empty()) {
+      break;
+    }
+    node = node->parent;
+  }
+}
+
 template<typename ObjectType>
 bool ValidateOctree(const OctreeNode<ObjectType>& node)
 {
@@ -131,7 +271,7 @@ bool ValidateOctree(const OctreeNode<ObjectType>& node)
 }
 
 template<typename ObjectType>
-void InsertObject(OctreeNode<ObjectType>& node, ObjectType& obj, OctreeNode<ObjectType>& root)
+void InsertObject(Octree<ObjectType>& tree, OctreeNode<ObjectType>& node, ObjectType& obj)
 {
   assert(node.IsValid());
   assert(obj.worldAABB.IsValid());
@@ -139,23 +279,19 @@ void InsertObject(OctreeNode<ObjectType>& node, ObjectType& obj, OctreeNode<Obje
 
   if (node.IsLeaf()) {
     if (ShouldSubdivide(node.BoxSize(), node.ObjectCount() + 1, node.depth)) {
-      const auto& subBoxes = SubdivideBox(node.bbox);
-      for (size_t i = 0; i < 8; ++i) {
-        assert(!node.children[i]);
-        assert(subBoxes[i].IsValid());
-        node.children[i] = new OctreeNode<ObjectType>(subBoxes[i], node.depth + 1, 1.5f);
-        node.children[i]->parent = &node;
-      }
+      SubdivideNode(tree, node);
 
-      // Reassign
-      auto oldObjects = std::move(node.objects);
-      assert(node.objects.empty());
+      // Reassign, both the node and the scratch list keep their capacity
+      std::vector<ObjectType*>& oldObjects = tree.ReassignList(node.depth);
+      oldObjects.assign(node.objects.begin(), node.objects.end());
+      node.objects.clear();
 
       for (auto* oldObj : oldObjects) {
-        InsertObject(root, *oldObj, root);  // Redirect to non-leaf branch
+        InsertObject(tree, tree.root, *oldObj);  // Redirect to non-leaf branch
       }
+      oldObjects.clear();
 
-      InsertObject(node, obj, root);  // Redirect to non-leaf branch
+      InsertObject(tree, node, obj);  // Redirect to non-leaf branch
 
     } else {
       // Leaf node that don't need to or cannot be subdivided further accepts the object
@@ -166,7 +302,7 @@ void InsertObject(OctreeNode<ObjectType>& node, ObjectType& obj, OctreeNode<Obje
     if (OctreeNode<ObjectType>* child = node.GetContainingChild(obj.worldAABB)) {
       assert(child->IsValid());
       assert(child->bbox.Contains(obj.worldAABB));
-      InsertObject(*child, obj, root);
+      InsertObject(tree, *child, obj);
     } else {
       // Cannot push down to children, has to accept in parent
       node.Attach(obj);
@@ -175,20 +311,104 @@ void InsertObject(OctreeNode<ObjectType>& node, ObjectType& obj, OctreeNode<Obje
 }
 
 template<typename ObjectType>
-std::unique_ptr<OctreeNode<ObjectType>>
-BuildSceneOctreeFromAABB(const AABB& sceneBox, std::vector<ObjectType>& objects)
+void BuildSceneOctreeFromAABB(
+  Octree<ObjectType>& tree,
+  const AABB& sceneBox,
+  std::vector<ObjectType>& objects
+)
 {
-  auto root = std::make_unique<OctreeNode<ObjectType>>(sceneBox, 0);
+  tree.Reset(sceneBox);
   for (ObjectType& obj : objects) {
-    InsertObject(*root, obj, *root);
+    InsertObject(tree, tree.root, obj);
+  }
+  assert(ValidateOctree(tree.root));
+}
+
+template<typename ObjectType>
+void BulkBuildOctreeNode(
+  Octree<ObjectType>& tree,
+  OctreeNode<ObjectType>& node,
+  std::vector<ObjectType*>& objects,
+  int parallelDepth
+)
+{
+  assert(node.IsLeaf());
+
+  if (!ShouldSubdivide(node.BoxSize(), objects.size(), node.depth)) {
+    node.objects.reserve(objects.size());
+    for (ObjectType* obj : objects) {
+      node.Attach(*obj);
+    }
+    return;
+  }
+
+  SubdivideNode(tree, node);
+
+  // One partition pass, objects that fit no child stay in this node
+  std::vector<ObjectType*> childObjects[8];
+  for (ObjectType* obj : objects) {
+    int childIndex = -1;
+    for (int i = 0; i < 8; ++i) {
+      if (node.children[i]->bbox.Contains(obj->worldAABB)) {
+        childIndex = i;
+        break;
+      }
+    }
+    if (childIndex < 0) {
+      node.Attach(*obj);
+    } else {
+      childObjects[childIndex].push_back(obj);
+    }
+  }
+  objects.clear();
+  objects.shrink_to_fit();
+
+  // Subtrees are disjoint, build the top levels as tasks of the shared job system
+  if (node.depth < parallelDepth) {
+    dxh::JobSystem& jobSystem = dxh::JobSystem::Shared();
+    dxh::TaskGroup group;
+    for (size_t i = 1; i < 8; ++i) {
+      jobSystem.Submit(group, [&, i]() {
+        BulkBuildOctreeNode(tree, *node.children[i], childObjects[i], parallelDepth);
+      });
+    }
+    BulkBuildOctreeNode(tree, *node.children[0], childObjects[0], parallelDepth);
+    jobSystem.Wait(group);
+  } else {
+    for (size_t i = 0; i < 8; ++i) {
+      BulkBuildOctreeNode(tree, *node.children[i], childObjects[i], parallelDepth);
+    }
   }
-  assert(ValidateOctree(*root));
-  return root;
 }
 
+// Builds the whole tree top-down in one partition pass per level instead of inserting objects one
+// by one from the root. Subtrees below `parallelDepth` are built as tasks of the shared job system
 template<typename ObjectType>
-bool UpdateOctreeObject(OctreeNode<ObjectType>& root, ObjectType& obj)
+void BulkBuildSceneOctreeFromAABB(
+  Octree<ObjectType>& tree,
+  const AABB& sceneBox,
+  std::vector<ObjectType>& objects,
+  int parallelDepth = 1
+)
 {
+  tree.Reset(sceneBox);
+
+  std::vector<ObjectType*> objectPtrs;
+  objectPtrs.reserve(objects.size());
+  for (ObjectType& obj : objects) {
+    assert(obj.worldAABB.IsValid());
+    assert(tree.root.bbox.Contains(obj.worldAABB));
+    objectPtrs.push_back(&obj);
+  }
+
+  BulkBuildOctreeNode(tree, tree.root, objectPtrs, parallelDepth);
+  assert(ValidateOctree(tree.root));
+}
+
+template<typename ObjectType>
+bool UpdateOctreeObject(Octree<ObjectType>& tree, ObjectType& obj)
+{
+  OctreeNode<ObjectType>& root = tree.root;
   assert(root.IsValid());
   assert(obj.worldAABB.IsValid());
   assert(root.bbox.Contains(obj.worldAABB));
@@ -203,13 +423,56 @@ bool UpdateOctreeObject(OctreeNode<ObjectType>& root, ObjectType& obj)
     // Try push down to children if possible
     if (auto* child = currentNode->GetContainingChild(objBox)) {
       currentNode->Detach(obj);
-      InsertObject(*child, obj, root);
+      InsertObject(tree, *child, obj);
       return true;
     }
     return false;
   }
 
   currentNode->Detach(obj);
-  InsertObject(root, obj, root);
+  if (currentNode->IsLeaf() && currentNode->objects.empty()) {
+    CollapseEmptyNodes(tree, currentNode->parent);
+  }
+  InsertObject(tree, root, obj);
+  return true;
+}
+
+// Queues `obj` for FlushOctreeDirtyList if its bounds left the loose box of its node, call after
+// changing obj.worldAABB. Movement within the loose margin needs no tree update. Each object is
+// queued at most once, objects not in the tree yet are ignored
+template<typename ObjectType>
+bool TrackOctreeObject(std::vector<ObjectType*>& dirtyList, ObjectType& obj)
+{
+  if (!obj.octreeNode || obj.octreeDirty || obj.octreeNode->bbox.Contains(obj.worldAABB)) {
+    return false;
+  }
+  obj.octreeDirty = true;
+  dirtyList.push_back(&obj);
   return true;
-}
\ No newline at end of file
+}
+
+// Updates only the queued objects, cost scales with what moved instead of with scene size.
+// Returns the number of objects that changed node
+template<typename ObjectType>
+size_t FlushOctreeDirtyList(Octree<ObjectType>& tree, std::vector<ObjectType*>& dirtyList)
+{
+  size_t movedCount = 0;
+  for (ObjectType* obj : dirtyList) {
+    obj->octreeDirty = false;
+    if (obj->octreeNode && UpdateOctreeObject(tree, *obj)) {
+      ++movedCount;
+    }
+  }
+  dirtyList.clear();
+  return movedCount;
+}
+
+// Drops queued objects, used when the tree is rebuilt from scratch
+template<typename ObjectType>
+void ClearOctreeDirtyList(std::vector<ObjectType*>& dirtyList)
+{
+  for (ObjectType* obj : dirtyList) {
+    obj->octreeDirty = false;
+  }
+  dirtyList.clear();
+}
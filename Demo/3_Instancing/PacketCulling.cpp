@@ -0,0 +1,231 @@
+#include "PacketCulling.h"
+
+#include <cassert>
+#include <cstdint>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+  #include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+  #include <intrin.h>
+#endif
+
+namespace
+{
+
+#if defined(__AVX512F__)
+constexpr size_t kPacketWidth = 16;
+#elif defined(__AVX2__)
+constexpr size_t kPacketWidth = 8;
+#else
+constexpr size_t kPacketWidth = 1;
+#endif
+
+// Frustum plane with the box corner closest to the plane already picked, see IntersectAABBPlane
+struct ResolvedPlane {
+  float a;
+  float b;
+  float c;
+  float d;
+  const float* x;
+  const float* y;
+  const float* z;
+};
+
+void ResolvePlanes(const Frustum& frustum, const AABBSoA& boxes, ResolvedPlane outPlanes[6])
+{
+  for (int i = 0; i < 6; ++i) {
+    const Plane& plane = frustum.planes[i];
+    ResolvedPlane& p = outPlanes[i];
+    p.a = plane.a;
+    p.b = plane.b;
+    p.c = plane.c;
+    p.d = plane.d;
+    p.x = (plane.a > 0) ? boxes.maxX.data() : boxes.minX.data();
+    p.y = (plane.b > 0) ? boxes.maxY.data() : boxes.minY.data();
+    p.z = (plane.c > 0) ? boxes.maxZ.data() : boxes.minZ.data();
+  }
+}
+
+// Evaluation order matches Plane::operator() so results are bit-identical to the AoS path
+bool IntersectScalar(const ResolvedPlane planes[6], size_t index)
+{
+  for (int i = 0; i < 6; ++i) {
+    const ResolvedPlane& p = planes[i];
+    float sign = p.a * p.x[index] + p.b * p.y[index] + p.c * p.z[index] + p.d;
+    if (!(sign > 0)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+[[maybe_unused]] int CountTrailingZeros(uint32_t bits)
+{
+#if defined(_MSC_VER)
+  unsigned long index;
+  _BitScanForward(&index, bits);
+  return static_cast<int>(index);
+#else
+  return __builtin_ctz(bits);
+#endif
+}
+
+[[maybe_unused]] void AppendPacketIndices(uint32_t bits, size_t base, std::vector<size_t>& out)
+{
+  while (bits) {
+    out.push_back(base + CountTrailingZeros(bits));
+    bits &= bits - 1;
+  }
+}
+
+[[maybe_unused]] void
+AppendPacketCandidates(uint32_t bits, const size_t* candidates, std::vector<size_t>& out)
+{
+  while (bits) {
+    out.push_back(candidates[CountTrailingZeros(bits)]);
+    bits &= bits - 1;
+  }
+}
+
+#if defined(__AVX512F__)
+
+__m512 Gather(const float* src, const size_t* indices)
+{
+  alignas(64) float values[16];
+  for (int i = 0; i < 16; ++i) {
+    values[i] = src[indices[i]];
+  }
+  return _mm512_load_ps(values);
+}
+
+template<bool gather>
+uint32_t IntersectPacket(const ResolvedPlane planes[6], size_t first, const size_t* candidates)
+{
+  __mmask16 mask = 0xFFFF;
+  const __m512 zero = _mm512_setzero_ps();
+  for (int i = 0; i < 6; ++i) {
+    const ResolvedPlane& p = planes[i];
+    __m512 x = gather ? Gather(p.x, candidates) : _mm512_loadu_ps(p.x + first);
+    __m512 y = gather ? Gather(p.y, candidates) : _mm512_loadu_ps(p.y + first);
+    __m512 z = gather ? Gather(p.z, candidates) : _mm512_loadu_ps(p.z + first);
+    __m512 sign = _mm512_mul_ps(_mm512_set1_ps(p.a), x);
+    sign = _mm512_add_ps(sign, _mm512_mul_ps(_mm512_set1_ps(p.b), y));
+    sign = _mm512_add_ps(sign, _mm512_mul_ps(_mm512_set1_ps(p.c), z));
+    sign = _mm512_add_ps(sign, _mm512_set1_ps(p.d));
+    mask = _mm512_mask_cmp_ps_mask(mask, sign, zero, _CMP_GT_OQ);
+    if (!mask) {
+      return 0;
+    }
+  }
+  return mask;
+}
+
+#elif defined(__AVX2__)
+
+__m256 Gather(const float* src, const size_t* indices)
+{
+  return _mm256_setr_ps(
+    src[indices[0]], src[indices[1]], src[indices[2]], src[indices[3]], src[indices[4]],
+    src[indices[5]], src[indices[6]], src[indices[7]]
+  );
+}
+
+template<bool gather>
+uint32_t IntersectPacket(const ResolvedPlane planes[6], size_t first, const size_t* candidates)
+{
+  __m256 mask = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+  const __m256 zero = _mm256_setzero_ps();
+  for (int i = 0; i < 6; ++i) {
+    const ResolvedPlane& p = planes[i];
+    __m256 x = gather ? Gather(p.x, candidates) : _mm256_loadu_ps(p.x + first);
+    __m256 y = gather ? Gather(p.y, candidates) : _mm256_loadu_ps(p.y + first);
+    __m256 z = gather ? Gather(p.z, candidates) : _mm256_loadu_ps(p.z + first);
+    __m256 sign = _mm256_mul_ps(_mm256_set1_ps(p.a), x);
+    sign = _mm256_add_ps(sign, _mm256_mul_ps(_mm256_set1_ps(p.b), y));
+    sign = _mm256_add_ps(sign, _mm256_mul_ps(_mm256_set1_ps(p.c), z));
+    sign = _mm256_add_ps(sign, _mm256_set1_ps(p.d));
+    mask = _mm256_and_ps(mask, _mm256_cmp_ps(sign, zero, _CMP_GT_OQ));
+    if (_mm256_testz_ps(mask, mask)) {
+      return 0;
+    }
+  }
+  return static_cast<uint32_t>(_mm256_movemask_ps(mask));
+}
+
+#endif
+
+}  // namespace
+
+void AABBSoA::Resize(size_t count)
+{
+  minX.resize(count);
+  minY.resize(count);
+  minZ.resize(count);
+  maxX.resize(count);
+  maxY.resize(count);
+  maxZ.resize(count);
+}
+
+size_t CullingPacketWidth()
+{
+  return kPacketWidth;
+}
+
+void CullAABBPacket(
+  const Frustum& frustum,
+  const AABBSoA& boxes,
+  size_t first,
+  size_t count,
+  std::vector<size_t>& outIndices
+)
+{
+  assert(first + count <= boxes.Size());
+
+  ResolvedPlane planes[6];
+  ResolvePlanes(frustum, boxes, planes);
+
+  size_t end = first + count;
+  size_t i = first;
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+  for (; i + kPacketWidth <= end; i += kPacketWidth) {
+    AppendPacketIndices(IntersectPacket<false>(planes, i, nullptr), i, outIndices);
+  }
+#endif
+
+  // Tail (or everything without SIMD)
+  for (; i < end; ++i) {
+    if (IntersectScalar(planes, i)) {
+      outIndices.push_back(i);
+    }
+  }
+}
+
+void CullAABBPacketIndexed(
+  const Frustum& frustum,
+  const AABBSoA& boxes,
+  const size_t* candidates,
+  size_t candidateCount,
+  std::vector<size_t>& outIndices
+)
+{
+  ResolvedPlane planes[6];
+  ResolvePlanes(frustum, boxes, planes);
+
+  size_t i = 0;
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+  for (; i + kPacketWidth <= candidateCount; i += kPacketWidth) {
+    const size_t* packet = candidates + i;
+    AppendPacketCandidates(IntersectPacket<true>(planes, 0, packet), packet, outIndices);
+  }
+#endif
+
+  for (; i < candidateCount; ++i) {
+    if (IntersectScalar(planes, candidates[i])) {
+      outIndices.push_back(candidates[i]);
+    }
+  }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "Culling.h"
+
+// Bounding boxes stored as structure of arrays, so a packet of boxes can be tested against one
+// plane with a single instruction
+struct AABBSoA {
+  std::vector<float> minX;
+  std::vector<float> minY;
+  std::vector<float> minZ;
+  std::vector<float> maxX;
+  std::vector<float> maxY;
+  std::vector<float> maxZ;
+
+  size_t Size() const { return minX.size(); }
+
+  void Resize(size_t count);
+
+  void Set(size_t index, const AABB& box)
+  {
+    minX[index] = box.min.x;
+    minY[index] = box.min.y;
+    minZ[index] = box.min.z;
+    maxX[index] = box.max.x;
+    maxY[index] = box.max.y;
+    maxZ[index] = box.max.z;
+  }
+
+  AABB Get(size_t index) const
+  {
+    return {{minX[index], minY[index], minZ[index]}, {maxX[index], maxY[index], maxZ[index]}};
+  }
+};
+
+// Number of boxes tested per instruction by the kernel selected at compile time (1 for scalar)
+size_t CullingPacketWidth();
+
+// Appends indices in [first, first + count) whose box intersects the frustum, in increasing order.
+// Results are identical to AABB::Intersect(const Frustum&)
+void CullAABBPacket(
+  const Frustum& frustum,
+  const AABBSoA& boxes,
+  size_t first,
+  size_t count,
+  std::vector<size_t>& outIndices
+);
+
+// Same test restricted to the given candidate indices, order of candidates is preserved
+void CullAABBPacketIndexed(
+  const Frustum& frustum,
+  const AABBSoA& boxes,
+  const size_t* candidates,
+  size_t candidateCount,
+  std::vector<size_t>& outIndices
+);
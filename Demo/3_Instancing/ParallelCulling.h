@@ -0,0 +1,101 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+#include "JobSystem.h"
+
+// Per-block output buffers kept between frames so workers don't reallocate every cull
+struct ParallelCullBuffers {
+  std::vector<std::vector<size_t>> chunks;
+  std::vector<size_t> offsets;
+};
+
+// 0 uses every participant of the shared job system
+inline size_t ResolveCullThreadCount(size_t requested)
+{
+  return requested > 0 ? requested : dxh::JobSystem::Shared().ParticipantCount();
+}
+
+// Blocks per thread, threads that finish early take the blocks of slower ones
+constexpr size_t kBlocksPerCullThread = 8;
+
+// Number of blocks [0, count) is cut into for `threadCount` threads, 1 runs on the calling thread
+inline size_t CullBlockCount(size_t count, size_t threadCount)
+{
+  threadCount = ResolveCullThreadCount(threadCount);
+  size_t blockCount = threadCount > 1 ? threadCount * kBlocksPerCullThread : 1;
+  return std::max<size_t>(1, std::min(blockCount, count));
+}
+
+// Splits [0, count) into CullBlockCount contiguous blocks and runs work(block, first, last) for
+// each of them through ParallelFor on the shared job system, on at most `threadCount` threads at
+// once. Returns the block count
+template<typename BlockWorkFunc>
+size_t ParallelForBlocks(size_t count, size_t threadCount, BlockWorkFunc work)
+{
+  size_t blockCount = CullBlockCount(count, threadCount);
+  auto blockBegin = [count, blockCount](size_t block) { return count * block / blockCount; };
+  dxh::JobSystem::Shared().ParallelFor(
+    0, blockCount,
+    [&](size_t firstBlock, size_t lastBlock) {
+      for (size_t block = firstBlock; block < lastBlock; ++block) {
+        work(block, blockBegin(block), blockBegin(block + 1));
+      }
+    },
+    1, ResolveCullThreadCount(threadCount)
+  );
+  return blockCount;
+}
+
+// Splits [0, count) into contiguous blocks. Each block is culled into its own buffer with
+// cullChunk(first, last, chunkOut), then the buffers are appended to `out` at offsets given by an
+// exclusive prefix sum of the block sizes. The appended range is compact and keeps the input order
+template<typename ChunkCullFunc>
+void ParallelCullChunks(
+  size_t count,
+  size_t threadCount,
+  ParallelCullBuffers& buffers,
+  std::vector<size_t>& out,
+  ChunkCullFunc cullChunk
+)
+{
+  size_t blockCount = CullBlockCount(count, threadCount);
+  if (buffers.chunks.size() < blockCount) {
+    buffers.chunks.resize(blockCount);
+  }
+  buffers.offsets.resize(blockCount + 1);
+
+  ParallelForBlocks(count, threadCount, [&](size_t block, size_t first, size_t last) {
+    std::vector<size_t>& chunkOut = buffers.chunks[block];
+    chunkOut.clear();
+    cullChunk(first, last, chunkOut);
+  });
+
+  buffers.offsets[0] = 0;
+  for (size_t block = 0; block < blockCount; ++block) {
+    buffers.offsets[block + 1] = buffers.offsets[block] + buffers.chunks[block].size();
+  }
+
+  size_t outBase = out.size();
+  out.resize(outBase + buffers.offsets[blockCount]);
+
+  dxh::JobSystem::Shared().ParallelFor(
+    0, blockCount,
+    [&](size_t firstBlock, size_t lastBlock) {
+      for (size_t block = firstBlock; block < lastBlock; ++block) {
+        const std::vector<size_t>& chunkOut = buffers.chunks[block];
+        if (!chunkOut.empty()) {
+          std::memcpy(
+            out.data() + outBase + buffers.offsets[block],
+            chunkOut.data(),
+            chunkOut.size() * sizeof(size_t)
+          );
+        }
+      }
+    },
+    1, ResolveCullThreadCount(threadCount)
+  );
+}
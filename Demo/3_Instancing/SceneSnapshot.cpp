@@ -0,0 +1,169 @@
+#include "SceneSnapshot.h"
+
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+
+constexpr char kSceneSnapshotMagic[8] = {'D', 'X', 'H', 'S', 'C', 'E', 'N', 'E'};
+constexpr uint64_t kSectionAlignment = 64;
+
+uint64_t AlignUp(uint64_t value, uint64_t alignment)
+{
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+SceneSnapshotHeader::Range& SectionRange(SceneSnapshotHeader& header, SceneSnapshotSection section)
+{
+  return header.sections[static_cast<size_t>(section)];
+}
+
+const SceneSnapshotHeader::Range& SectionRange(
+  const SceneSnapshotHeader& header,
+  SceneSnapshotSection section
+)
+{
+  return header.sections[static_cast<size_t>(section)];
+}
+
+// Typed start of a section that lies inside the file, null when out of range or misaligned
+template<typename T>
+const T* SectionData(
+  const uint8_t* file,
+  size_t fileSize,
+  const SceneSnapshotHeader::Range& range,
+  size_t& outCount
+)
+{
+  if (range.offset % kSectionAlignment != 0 || range.size % sizeof(T) != 0 ||
+      range.offset > fileSize || range.size > fileSize - range.offset) {
+    return nullptr;
+  }
+  outCount = static_cast<size_t>(range.size / sizeof(T));
+  return reinterpret_cast<const T*>(file + range.offset);
+}
+
+// Node links and object ranges stay inside the arrays, so culling never reads past them
+bool IsOctreeValid(const SceneSnapshotContents& contents)
+{
+  for (size_t i = 0; i < contents.octreeNodeCount; ++i) {
+    const LinearOctreeNode& node = contents.octreeNodes[i];
+    if (node.skip <= i || node.skip > contents.octreeNodeCount ||
+        node.firstObject > contents.octreeObjectCount ||
+        node.objectCount > contents.octreeObjectCount - node.firstObject) {
+      return false;
+    }
+  }
+  for (size_t k = 0; k < contents.octreeObjectCount; ++k) {
+    if (contents.octreeObjects[k] >= contents.instanceCount) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+bool WriteSceneSnapshot(const std::string& path, const SceneSnapshotContents& contents)
+{
+  SceneSnapshotHeader header{};
+  std::memcpy(header.magic, kSceneSnapshotMagic, sizeof(header.magic));
+  header.version = kSceneSnapshotVersion;
+  header.headerSize = sizeof(SceneSnapshotHeader);
+  header.instanceDataSize = sizeof(InstanceData);
+  header.instanceBoundsSize = sizeof(InstanceBounds);
+  header.octreeNodeSize = sizeof(LinearOctreeNode);
+  header.instanceCount = contents.instanceCount;
+  header.generatorKey = contents.generatorKey;
+
+  struct SectionSource {
+    SceneSnapshotSection section;
+    const void* data;
+    uint64_t size;
+  };
+  const SectionSource sources[] = {
+    {SceneSnapshotSection::Instances, contents.instances,
+     contents.instanceCount * sizeof(InstanceData)},
+    {SceneSnapshotSection::Bounds, contents.bounds,
+     contents.instanceCount * sizeof(InstanceBounds)},
+    {SceneSnapshotSection::OctreeNodes, contents.octreeNodes,
+     contents.octreeNodeCount * sizeof(LinearOctreeNode)},
+    {SceneSnapshotSection::OctreeObjects, contents.octreeObjects,
+     contents.octreeObjectCount * sizeof(uint32_t)}
+  };
+
+  uint64_t offset = sizeof(SceneSnapshotHeader);
+  for (const SectionSource& source : sources) {
+    offset = AlignUp(offset, kSectionAlignment);
+    SectionRange(header, source.section) = {offset, source.size};
+    offset += source.size;
+  }
+
+  std::ofstream file{path, std::ios::binary | std::ios::trunc};
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  const char padding[kSectionAlignment] = {};
+  for (const SectionSource& source : sources) {
+    const SceneSnapshotHeader::Range& range = SectionRange(header, source.section);
+    file.write(padding, static_cast<std::streamsize>(range.offset - file.tellp()));
+    file.write(static_cast<const char*>(source.data), static_cast<std::streamsize>(source.size));
+  }
+  return static_cast<bool>(file);
+}
+
+bool SceneSnapshot::Open(const std::string& path)
+{
+  contents = {};
+  if (!file.Open(path)) {
+    return false;
+  }
+
+  const auto* bytes = static_cast<const uint8_t*>(file.Data());
+  size_t size = file.Size();
+  if (size < sizeof(SceneSnapshotHeader)) {
+    file.Close();
+    return false;
+  }
+
+  const auto& header = *reinterpret_cast<const SceneSnapshotHeader*>(bytes);
+  bool compatible = std::memcmp(header.magic, kSceneSnapshotMagic, sizeof(header.magic)) == 0 &&
+                    header.version == kSceneSnapshotVersion &&
+                    header.headerSize == sizeof(SceneSnapshotHeader) &&
+                    header.instanceDataSize == sizeof(InstanceData) &&
+                    header.instanceBoundsSize == sizeof(InstanceBounds) &&
+                    header.octreeNodeSize == sizeof(LinearOctreeNode);
+  if (!compatible) {
+    file.Close();
+    return false;
+  }
+
+  SceneSnapshotContents mapped;
+  size_t instanceCount = 0;
+  size_t boundsCount = 0;
+  mapped.instances = SectionData<InstanceData>(
+    bytes, size, SectionRange(header, SceneSnapshotSection::Instances), instanceCount
+  );
+  mapped.bounds = SectionData<InstanceBounds>(
+    bytes, size, SectionRange(header, SceneSnapshotSection::Bounds), boundsCount
+  );
+  mapped.octreeNodes = SectionData<LinearOctreeNode>(
+    bytes, size, SectionRange(header, SceneSnapshotSection::OctreeNodes), mapped.octreeNodeCount
+  );
+  mapped.octreeObjects = SectionData<uint32_t>(
+    bytes, size, SectionRange(header, SceneSnapshotSection::OctreeObjects),
+    mapped.octreeObjectCount
+  );
+  mapped.instanceCount = instanceCount;
+  mapped.generatorKey = header.generatorKey;
+
+  bool valid = mapped.instances && mapped.bounds && mapped.octreeNodes && mapped.octreeObjects &&
+               instanceCount == header.instanceCount && boundsCount == instanceCount &&
+               IsOctreeValid(mapped);
+  if (!valid) {
+    file.Close();
+    return false;
+  }
+
+  contents = mapped;
+  return true;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "Instances.h"
+#include "LinearOctree.h"
+#include "MappedFile.h"
+
+// Binary scene file that is mapped and used in place: a header followed by arrays of plain structs
+// at 64-byte aligned offsets. It holds no pointers, the octree refers to nodes and objects by
+// index. Written in the byte order and struct layouts of the build, other builds reject it. The
+// generator key tells snapshots of another scene generator apart
+
+// Bounds of an instance, InstanceSceneInfo without its octree bookkeeping
+struct InstanceBounds {
+  DirectX::XMFLOAT3 worldPosition;
+  AABB worldAABB;
+  Sphere worldSphere;
+  OBB worldOBB;
+};
+
+enum class SceneSnapshotSection : uint32_t {
+  Instances,      // InstanceData[instanceCount]
+  Bounds,         // InstanceBounds[instanceCount]
+  OctreeNodes,    // LinearOctreeNode[], pre-order
+  OctreeObjects,  // uint32_t[], instance indices referenced by the nodes
+  Count
+};
+
+constexpr uint32_t kSceneSnapshotVersion = 2;
+
+struct SceneSnapshotHeader {
+  char magic[8];  // "DXHSCENE"
+  uint32_t version;
+  uint32_t headerSize;
+
+  // Layout of the build that wrote the file
+  uint32_t instanceDataSize;
+  uint32_t instanceBoundsSize;
+  uint32_t octreeNodeSize;
+  uint32_t reserved;
+
+  uint64_t instanceCount;
+  uint64_t generatorKey;  // SceneGeneratorKey of the writer, see Instances.cpp
+
+  // Byte offset and size of each section from the start of the file
+  struct Range {
+    uint64_t offset;
+    uint64_t size;
+  } sections[static_cast<size_t>(SceneSnapshotSection::Count)];
+};
+
+// Arrays of a snapshot, the octree is optional
+struct SceneSnapshotContents {
+  uint64_t generatorKey = 0;
+  const InstanceData* instances = nullptr;
+  const InstanceBounds* bounds = nullptr;
+  size_t instanceCount = 0;
+  const LinearOctreeNode* octreeNodes = nullptr;
+  size_t octreeNodeCount = 0;
+  const uint32_t* octreeObjects = nullptr;
+  size_t octreeObjectCount = 0;
+};
+
+bool WriteSceneSnapshot(const std::string& path, const SceneSnapshotContents& contents);
+
+// Read-only mapping of a snapshot, the arrays of Contents() point into it while it stays open
+class SceneSnapshot
+{
+public:
+  // Maps `path` and checks the header and every section range. False when the file is missing,
+  // truncated, of another version or written with other struct layouts. The generator key is left
+  // to the caller
+  bool Open(const std::string& path);
+
+  const SceneSnapshotContents& Contents() const { return contents; }
+
+private:
+  dxh::MappedFile file;
+  SceneSnapshotContents contents;
+};
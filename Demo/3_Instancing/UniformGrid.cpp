@@ -0,0 +1,141 @@
+#include "UniformGrid.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+void UniformGrid::Build(const AABBSoA& bounds, const AABB& box, float size)
+{
+  assert(size > 0.f);
+  sceneBox = box;
+  cellSize = size;
+  margin = 0.f;
+  columnCount = std::max(1, static_cast<int>(std::ceil((box.max.x - box.min.x) / cellSize)));
+  rowCount = std::max(1, static_cast<int>(std::ceil((box.max.z - box.min.z) / cellSize)));
+
+  // Cleared cells keep their capacity, rebuilding a similar scene does not allocate
+  cells.resize(static_cast<size_t>(columnCount) * rowCount);
+  for (auto& cell : cells) {
+    cell.clear();
+  }
+
+  auto count = static_cast<uint32_t>(bounds.Size());
+  objectCells.resize(count);
+  objectSlots.resize(count);
+  for (uint32_t i = 0; i < count; ++i) {
+    AABB objBox = bounds.Get(i);
+    GrowMargin(HalfExtent(objBox));
+    uint32_t cell = CellIndex(objBox);
+    objectCells[i] = cell;
+    objectSlots[i] = static_cast<uint32_t>(cells[cell].size());
+    cells[cell].push_back(i);
+  }
+}
+
+void UniformGrid::Update(uint32_t index, const AABB& box)
+{
+  assert(index < objectCells.size());
+  GrowMargin(HalfExtent(box));
+
+  uint32_t cell = CellIndex(box);
+  uint32_t oldCell = objectCells[index];
+  if (cell == oldCell) {
+    return;
+  }
+
+  // Swap with the last object of the old cell
+  std::vector<uint32_t>& oldObjects = cells[oldCell];
+  uint32_t slot = objectSlots[index];
+  uint32_t last = oldObjects.back();
+  oldObjects[slot] = last;
+  objectSlots[last] = slot;
+  oldObjects.pop_back();
+
+  objectCells[index] = cell;
+  objectSlots[index] = static_cast<uint32_t>(cells[cell].size());
+  cells[cell].push_back(index);
+}
+
+bool UniformGrid::NeedsUpdate(uint32_t index, const AABB& box) const
+{
+  assert(index < objectCells.size());
+  return CellIndex(box) != objectCells[index];
+}
+
+void UniformGrid::Update(const AABBSoA& bounds, const std::vector<uint32_t>& indices)
+{
+  assert(bounds.Size() == objectCells.size());
+  for (uint32_t index : indices) {
+    Update(index, bounds.Get(index));
+  }
+}
+
+void UniformGrid::Cull(
+  const Frustum& frustum,
+  std::vector<size_t>& outAccepted,
+  std::vector<size_t>& outCandidates
+) const
+{
+  if (cells.empty()) {
+    return;
+  }
+
+  // Cells whose loose box can overlap the bounds of the frustum
+  AABB footprint = FrustumAABB(frustum);
+  int x0 = Column(footprint.min.x - margin);
+  int x1 = Column(footprint.max.x + margin);
+  int z0 = Row(footprint.min.z - margin);
+  int z1 = Row(footprint.max.z + margin);
+
+  for (int z = z0; z <= z1; ++z) {
+    for (int x = x0; x <= x1; ++x) {
+      const std::vector<uint32_t>& objects = CellObjects(x, z);
+      if (objects.empty()) {
+        continue;
+      }
+
+      uint8_t planeMask = kAllFrustumPlanes;
+      CullResult result = ClassifyAABB(CellBounds(x, z), frustum, planeMask);
+      if (result == CullResult::Outside) {
+        continue;
+      }
+      std::vector<size_t>& out = result == CullResult::Inside ? outAccepted : outCandidates;
+      out.insert(out.end(), objects.begin(), objects.end());
+    }
+  }
+}
+
+AABB UniformGrid::CellBounds(int x, int z) const
+{
+  float minX = sceneBox.min.x + static_cast<float>(x) * cellSize;
+  float minZ = sceneBox.min.z + static_cast<float>(z) * cellSize;
+  return {
+    {minX - margin, sceneBox.min.y, minZ - margin},
+    {minX + cellSize + margin, sceneBox.max.y, minZ + cellSize + margin}
+  };
+}
+
+int UniformGrid::Column(float x) const
+{
+  float column = std::floor((x - sceneBox.min.x) / cellSize);
+  return static_cast<int>(std::clamp(column, 0.f, static_cast<float>(columnCount - 1)));
+}
+
+int UniformGrid::Row(float z) const
+{
+  float row = std::floor((z - sceneBox.min.z) / cellSize);
+  return static_cast<int>(std::clamp(row, 0.f, static_cast<float>(rowCount - 1)));
+}
+
+uint32_t UniformGrid::CellIndex(const AABB& box) const
+{
+  assert(box.min.y >= sceneBox.min.y && box.max.y <= sceneBox.max.y);
+  int x = Column((box.min.x + box.max.x) * 0.5f);
+  int z = Row((box.min.z + box.max.z) * 0.5f);
+  return static_cast<uint32_t>(z * columnCount + x);
+}
+
+float UniformGrid::HalfExtent(const AABB& box)
+{
+  return std::max(box.max.x - box.min.x, box.max.z - box.min.z) * 0.5f;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "Culling.h"
+#include "PacketCulling.h"
+
+// Flat grid of square cells over the XZ extent of the scene, every cell spans the full scene
+// height. Objects live in the cell holding their box center, so moving one is O(1). Cell boxes are
+// widened by the largest object half extent seen, which keeps every object inside its cell box
+class UniformGrid
+{
+public:
+  // Object i of `bounds` is reported as index i. Box centers must lie inside `sceneBox`
+  void Build(const AABBSoA& bounds, const AABB& sceneBox, float cellSize);
+
+  // Moves object `index` to the cell of its new center
+  void Update(uint32_t index, const AABB& box);
+
+  // True when object `index` left its cell with bounds `box`, only those objects need Update.
+  // Thread safe while the grid is not modified
+  bool NeedsUpdate(uint32_t index, const AABB& box) const;
+
+  // Widens cell boxes to hold objects with X and Z half extents up to `halfExtent`, for objects
+  // that grew without leaving their cell
+  void GrowMargin(float halfExtent) { margin = std::max(margin, halfExtent); }
+
+  // Largest X or Z half extent of `box`
+  static float HalfExtent(const AABB& box);
+
+  // Updates the objects listed in `indices` to their bounds in `bounds`, duplicates are fine
+  void Update(const AABBSoA& bounds, const std::vector<uint32_t>& indices);
+
+  // Visits the cells under the XZ footprint of the frustum. Objects of cells fully inside go to
+  // `outAccepted` and need no further test, objects of cells only intersecting it go to
+  // `outCandidates`
+  void Cull(
+    const Frustum& frustum,
+    std::vector<size_t>& outAccepted,
+    std::vector<size_t>& outCandidates
+  ) const;
+
+  bool Empty() const { return cells.empty(); }
+
+  int ColumnCount() const { return columnCount; }
+  int RowCount() const { return rowCount; }
+
+  // Loose box of the cell at column x (along X) and row z (along Z)
+  AABB CellBounds(int x, int z) const;
+
+  const std::vector<uint32_t>& CellObjects(int x, int z) const
+  {
+    return cells[z * columnCount + x];
+  }
+
+private:
+  int Column(float x) const;
+  int Row(float z) const;
+  uint32_t CellIndex(const AABB& box) const;
+
+  AABB sceneBox;
+  float cellSize = 1.f;
+  int columnCount = 0;
+  int rowCount = 0;
+  float margin = 0.f;  // Largest object half extent on X and Z
+
+  std::vector<std::vector<uint32_t>> cells;
+  std::vector<uint32_t> objectCells;
+  std::vector<uint32_t> objectSlots;  // Position of each object in its cell
+};
@@ -0,0 +1,41 @@
+#pragma once
+
+// Minimal stand-in for the SAL header of the Windows SDK, which DirectXMath includes outside
+// Windows. Annotations only feed the MSVC code analysis, so every one used by the DirectXMath
+// headers expands to nothing
+
+// Parameters
+#define _In_
+#define _In_opt_
+#define _In_z_
+#define _In_reads_(size)
+#define _In_reads_opt_(size)
+#define _In_reads_bytes_(size)
+#define _In_range_(low, high)
+#define _Inout_
+#define _Inout_opt_
+#define _Inout_updates_(size)
+#define _Inout_updates_bytes_(size)
+#define _Out_
+#define _Out_opt_
+#define _Out_writes_(size)
+#define _Out_writes_opt_(size)
+#define _Out_writes_bytes_(size)
+#define _Out_writes_all_(size)
+#define _Out_range_(low, high)
+#define _Outptr_
+#define _Outptr_opt_
+
+// Functions and return values
+#define _Check_return_
+#define _Must_inspect_result_
+#define _Ret_maybenull_
+#define _Ret_notnull_
+#define _Success_(expr)
+#define _Use_decl_annotations_
+#define _When_(expr, annotations)
+
+// Analysis hints
+#define _Analysis_assume_(expr)
+#define _Pre_satisfies_(expr)
+#define _Post_satisfies_(expr)
@@ -11,15 +11,98 @@ cbuffer ConstantBuffer : register(b0)
     float3 ambient;
 }
 
+// Each LOD is a separate draw, SV_InstanceID restarts at 0 so the draw passes where its
+// instances start
+cbuffer DrawConstants : register(b1)
+{
+    uint instanceOffset;
+    uint useVisibleIndices;  // Instances are read through g_visibleIndices
+}
+
+// Instance layout, matches InstanceFormat and is set by the application for each PSO
+#define INSTANCE_FORMAT_FULL 0
+#define INSTANCE_FORMAT_AFFINE 1
+#define INSTANCE_FORMAT_QUAT_POS_SCALE 2
+
+#ifndef INSTANCE_FORMAT
+#define INSTANCE_FORMAT INSTANCE_FORMAT_FULL
+#endif
+
+#if INSTANCE_FORMAT == INSTANCE_FORMAT_AFFINE
+struct InstanceData
+{
+    row_major float3x4 world;  // Transposed world matrix, row i yields world space coordinate i
+    uint albedo;               // RGBA8
+};
+#elif INSTANCE_FORMAT == INSTANCE_FORMAT_QUAT_POS_SCALE
+struct InstanceData
+{
+    float4 rotation;
+    float3 position;
+    float scale;
+    uint albedo;  // RGBA8
+};
+#else
 struct InstanceData
 {
     float4x4 world;
     float4x4 invWorld;
     float4 albedo;
 };
+#endif
 
 StructuredBuffer<InstanceData> g_instanceBuffer : register(t0);
 
+// Culled instance indices, g_instanceBuffer then holds every instance in scene order
+StructuredBuffer<uint> g_visibleIndices : register(t1);
+
+float4 UnpackRGBA8(uint c)
+{
+    return float4(c & 0xff, (c >> 8) & 0xff, (c >> 16) & 0xff, c >> 24) / 255.0f;
+}
+
+float3 RotateByQuaternion(float4 q, float3 v)
+{
+    float3 t = 2.0f * cross(q.xyz, v);
+    return v + q.w * t + cross(q.xyz, t);
+}
+
+struct WorldVertex
+{
+    float3 position;
+    float3 normal;  // Not normalized
+    float4 albedo;
+};
+
+WorldVertex TransformToWorld(InstanceData instance, float3 position, float3 normal)
+{
+    WorldVertex res;
+#if INSTANCE_FORMAT == INSTANCE_FORMAT_AFFINE
+    res.position = mul(instance.world, float4(position, 1.0f));
+    // Columns of the inverse transpose are cross products of the linear part's columns, up to
+    // the determinant whose sign keeps mirrored instances facing out
+    float3 c0 = instance.world._m00_m10_m20;
+    float3 c1 = instance.world._m01_m11_m21;
+    float3 c2 = instance.world._m02_m12_m22;
+    float3 c12 = cross(c1, c2);
+    float3x3 cofactor = float3x3(c12, cross(c2, c0), cross(c0, c1));
+    res.normal = mul(normal, cofactor) * sign(dot(c0, c12));
+    res.albedo = UnpackRGBA8(instance.albedo);
+#elif INSTANCE_FORMAT == INSTANCE_FORMAT_QUAT_POS_SCALE
+    res.position = RotateByQuaternion(instance.rotation, position * instance.scale);
+    res.position += instance.position;
+    // The inverse transpose of scale * rotation has the sign of the scale
+    res.normal = RotateByQuaternion(instance.rotation, normal) * sign(instance.scale);
+    res.albedo = UnpackRGBA8(instance.albedo);
+#else
+    res.position = mul(instance.world, float4(position, 1.0f)).xyz;
+    float4x4 normalMat = transpose(instance.invWorld);
+    res.normal = mul(normalMat, float4(normal, 0.0f)).xyz;
+    res.albedo = instance.albedo;
+#endif
+    return res;
+}
+
 struct VSInput
 {
     float3 position : POSITION;
@@ -38,14 +121,13 @@ struct PSInput
 PSInput MainVS(VSInput input)
 {
     PSInput output;
-    float4x4 world = g_instanceBuffer[input.instanceID].world;
-    output.position = mul(projection, mul(view, mul(world, float4(input.position, 1.0f))));
-
-    output.albedo = g_instanceBuffer[input.instanceID].albedo;
-
-    float4x4 invWorld = g_instanceBuffer[input.instanceID].invWorld;
-    float4x4 normalMat = transpose(invWorld);
-    output.normal = mul(normalMat, float4(input.normal, 0.0f)).xyz;
+    uint visibleIndex = instanceOffset + input.instanceID;
+    uint instanceIndex = useVisibleIndices ? g_visibleIndices[visibleIndex] : visibleIndex;
+    WorldVertex vertex =
+        TransformToWorld(g_instanceBuffer[instanceIndex], input.position, input.normal);
+    output.position = mul(projection, mul(view, float4(vertex.position, 1.0f)));
+    output.albedo = vertex.albedo;
+    output.normal = vertex.normal;
 
     return output;
 }